@@ -0,0 +1,133 @@
+#include "CandidateSet.h"
+
+#include "constants.h"
+#include "point_quadtree/Circle.h"
+
+#include <algorithm> // is_sorted, max, min, sort, unique
+#include <array>
+#include <cmath> // sqrt
+
+CandidateSet::CandidateSet(const std::vector<primitives::space_t>& x
+    , const std::vector<primitives::space_t>& y
+    , const point_quadtree::Tree& tree
+    , const point_quadtree::Domain& domain
+    , size_t nearest
+    , size_t per_quadrant)
+{
+    const auto point_count {x.size()};
+    m_offsets.reserve(point_count + 1);
+    m_offsets.push_back(0);
+    m_neighbors.reserve(point_count * (nearest + 4 * per_quadrant));
+    // radius expected to contain nearest + 1 points for uniformly distributed points.
+    const auto area {domain.xdim(0) * domain.ydim(0)};
+    const auto diagonal {std::sqrt(domain.xdim(0) * domain.xdim(0) + domain.ydim(0) * domain.ydim(0))};
+    const auto initial_radius {std::max(std::sqrt(area * (nearest + 1) / (constants::pi * point_count)), diagonal * 1e-9)};
+
+    std::vector<primitives::point_id_t> points;
+    std::vector<std::pair<primitives::space_t, primitives::point_id_t>> by_distance;
+    std::vector<primitives::point_id_t> selected;
+    for (primitives::point_id_t i {0}; i < point_count; ++i)
+    {
+        auto squared_distance = [&x, &y, i](primitives::point_id_t p)
+        {
+            const auto dx {x[p] - x[i]};
+            const auto dy {y[p] - y[i]};
+            return dx * dx + dy * dy;
+        };
+        Circle circle;
+        circle.x = x[i];
+        circle.y = y[i];
+        circle.radius = initial_radius;
+        // nearest neighbors.
+        while (true)
+        {
+            points.clear();
+            tree.get_points(i, circle, points);
+            if (points.size() > nearest or circle.radius >= diagonal)
+            {
+                break;
+            }
+            circle.radius *= 2;
+        }
+        by_distance.clear();
+        for (auto p : points)
+        {
+            if (p != i)
+            {
+                by_distance.push_back({squared_distance(p), p});
+            }
+        }
+        const auto nearest_count {std::min(nearest, by_distance.size())};
+        std::partial_sort(std::begin(by_distance), std::begin(by_distance) + nearest_count, std::end(by_distance));
+        selected.clear();
+        for (size_t k {0}; k < nearest_count; ++k)
+        {
+            selected.push_back(by_distance[k].second);
+        }
+        // quadrant neighbors.
+        if (per_quadrant > 0)
+        {
+            const auto kth_distance {nearest_count > 0 ? std::sqrt(by_distance[nearest_count - 1].first) : initial_radius};
+            const auto max_radius {std::max(kth_distance, initial_radius) * constants::quadrant_search_factor};
+            std::array<std::vector<std::pair<primitives::space_t, primitives::point_id_t>>, 4> quadrants;
+            while (true)
+            {
+                for (auto& quadrant : quadrants)
+                {
+                    quadrant.clear();
+                }
+                for (auto p : points)
+                {
+                    if (p == i)
+                    {
+                        continue;
+                    }
+                    const auto q {(x[p] >= x[i] ? 2 : 0) + (y[p] >= y[i] ? 1 : 0)};
+                    quadrants[q].push_back({squared_distance(p), p});
+                }
+                const bool filled {std::all_of(std::cbegin(quadrants), std::cend(quadrants)
+                    , [per_quadrant](const auto& quadrant) { return quadrant.size() >= per_quadrant; })};
+                if (filled or circle.radius >= max_radius)
+                {
+                    break;
+                }
+                circle.radius = std::min(circle.radius * 2, max_radius);
+                points.clear();
+                tree.get_points(i, circle, points);
+            }
+            for (auto& quadrant : quadrants)
+            {
+                const auto count {std::min(per_quadrant, quadrant.size())};
+                std::partial_sort(std::begin(quadrant), std::begin(quadrant) + count, std::end(quadrant));
+                for (size_t k {0}; k < count; ++k)
+                {
+                    selected.push_back(quadrant[k].second);
+                }
+            }
+        }
+        std::sort(std::begin(selected), std::end(selected));
+        selected.erase(std::unique(std::begin(selected), std::end(selected)), std::end(selected));
+        std::sort(std::begin(selected), std::end(selected)
+            , [&squared_distance](auto a, auto b)
+            {
+                const auto da {squared_distance(a)};
+                const auto db {squared_distance(b)};
+                return da < db or (da == db and a < b);
+            });
+        m_neighbors.insert(std::end(m_neighbors), std::cbegin(selected), std::cend(selected));
+        m_offsets.push_back(m_neighbors.size());
+    }
+}
+
+void CandidateSet::compute_lengths(LengthMap& length_map)
+{
+    m_lengths.resize(m_neighbors.size());
+    m_lengths_sorted = true;
+    for (primitives::point_id_t i {0}; i + 1u < m_offsets.size(); ++i)
+    {
+        auto* first {m_lengths.data() + m_offsets[i]};
+        auto* last {m_lengths.data() + m_offsets[i + 1]};
+        length_map.lengths(i, m_neighbors.data() + m_offsets[i], last - first, first);
+        m_lengths_sorted = m_lengths_sorted and std::is_sorted(first, last);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Fixed candidate neighbors per point, computed once with the quadtree.
+// Each point's candidates are the K nearest points plus the Q nearest points
+//  in each of the 4 quadrants around it (to avoid all candidates lying on one side),
+//  stored in compressed sparse row form and sorted by increasing distance.
+// Quadrant neighbors are only searched up to constants::quadrant_search_factor
+//  times the K-th nearest distance, so points near the boundary of the domain
+//  do not trigger whole-domain queries.
+// compute_lengths() stores the candidate edge lengths once, so that every search
+//  sharing the set (parallel workers, multistart starts) reads the same array.
+// Stored lengths follow the candidate order unless the LengthMap storage is not exact
+//  (float32), where rounding can put a longer length before a shorter one; see lengths_sorted().
+
+#include "LengthMap.h"
+#include "point_quadtree/Domain.h"
+#include "point_quadtree/Tree.h"
+#include "primitives.h"
+
+#include <vector>
+
+class CandidateSet
+{
+public:
+    struct Range
+    {
+        const primitives::point_id_t* first {nullptr};
+        const primitives::point_id_t* last {nullptr};
+        const primitives::point_id_t* begin() const { return first; }
+        const primitives::point_id_t* end() const { return last; }
+        size_t size() const { return last - first; }
+    };
+
+    CandidateSet(const std::vector<primitives::space_t>& x
+        , const std::vector<primitives::space_t>& y
+        , const point_quadtree::Tree&
+        , const point_quadtree::Domain&
+        , size_t nearest
+        , size_t per_quadrant);
+
+    Range neighbors(primitives::point_id_t i) const
+    {
+        return {m_neighbors.data() + m_offsets[i], m_neighbors.data() + m_offsets[i + 1]};
+    }
+    size_t size() const { return m_neighbors.size(); }
+
+    // Lengths must come from a LengthMap with the same coordinates and storage as the searches.
+    void compute_lengths(LengthMap&);
+    bool has_lengths() const { return m_lengths.size() == m_neighbors.size(); }
+    // Lengths of point i's candidates, parallel to neighbors(i).
+    const primitives::length_t* lengths(primitives::point_id_t i) const { return m_lengths.data() + m_offsets[i]; }
+    // If every point's candidate lengths are non-decreasing.
+    bool lengths_sorted() const { return m_lengths_sorted; }
+
+private:
+    std::vector<size_t> m_offsets; // point i's candidates are [m_offsets[i], m_offsets[i + 1]).
+    std::vector<primitives::point_id_t> m_neighbors;
+    std::vector<primitives::length_t> m_lengths; // parallel to m_neighbors.
+    bool m_lengths_sorted {true};
+};
@@ -0,0 +1,201 @@
+#include "Checkpointer.h"
+
+#include <algorithm> // max, min
+#include <charconv> // from_chars, to_chars
+#include <cstdint>
+#include <cstdio> // fopen, fwrite, rename, snprintf
+#include <cstring> // memcpy
+#include <filesystem>
+#include <iostream>
+#include <utility> // move, swap
+
+Checkpointer::Checkpointer(std::string directory, std::string instance_key, size_t save_period, double save_seconds)
+    : m_directory(std::move(directory))
+    , m_instance_key(std::move(instance_key))
+    , m_save_period(std::max(save_period, static_cast<size_t>(1)))
+    , m_save_seconds(save_seconds)
+    , m_last_save(Clock::now())
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error)
+    {
+        std::cout << __func__ << ": error: could not create checkpoint directory "
+            << m_directory << ": " << error.message() << "; checkpoints are disabled." << std::endl;
+        m_enabled = false;
+        return;
+    }
+    m_writer = std::thread(&Checkpointer::write_loop, this);
+}
+
+Checkpointer::~Checkpointer()
+{
+    if (not m_writer.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+}
+
+void Checkpointer::offer(const Tour& tour)
+{
+    if (not m_enabled)
+    {
+        return;
+    }
+    ++m_improvements;
+    if (m_improvements < m_save_period or Clock::now() - m_last_save < m_save_seconds)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (not busy())
+    {
+        save(tour);
+    }
+}
+
+void Checkpointer::flush(const Tour& tour)
+{
+    if (not m_enabled)
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return not busy(); });
+    if (m_improvements > 0)
+    {
+        save(tour);
+        m_idle.wait(lock, [this] { return not busy(); });
+    }
+}
+
+void Checkpointer::save(const Tour& tour)
+{
+    m_snapshot = tour.order();
+    m_snapshot_length = tour.length();
+    m_pending = true;
+    m_improvements = 0;
+    m_last_save = Clock::now();
+    m_wake.notify_one();
+}
+
+void Checkpointer::write_loop()
+{
+    std::vector<primitives::point_id_t> order;
+    while (true)
+    {
+        primitives::length_t length {0};
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_exit or m_pending; });
+            if (not m_pending)
+            {
+                return;
+            }
+            std::swap(order, m_snapshot);
+            length = m_snapshot_length;
+            m_pending = false;
+            m_writing = true;
+        }
+        write(order, length);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_writing = false;
+        }
+        m_idle.notify_all();
+    }
+}
+
+void Checkpointer::write(const std::vector<primitives::point_id_t>& order, primitives::length_t length)
+{
+    // same format as fileio::write_ordered_points.
+    m_buffer.clear();
+    m_buffer += "DIMENSION: " + std::to_string(order.size()) + "\nTOUR_SECTION\n";
+    const auto header_size {m_buffer.size()};
+    constexpr size_t max_line_size {12}; // 10 digits and a newline, rounded up.
+    m_buffer.resize(header_size + order.size() * max_line_size);
+    auto cursor {m_buffer.data() + header_size};
+    for (auto p : order)
+    {
+        cursor = std::to_chars(cursor, m_buffer.data() + m_buffer.size(), p + 1).ptr;
+        *cursor++ = '\n';
+    }
+    m_buffer.resize(cursor - m_buffer.data());
+
+    const auto name {"test_" + m_instance_key + "_" + std::to_string(length) + ".txt"};
+    const auto path {m_directory + "/" + name};
+    const auto temporary_path {m_directory + "/." + name + ".tmp"};
+    auto file {std::fopen(temporary_path.c_str(), "wb")};
+    if (not file)
+    {
+        std::cout << __func__ << ": error: could not open " << temporary_path << std::endl;
+        return;
+    }
+    const bool written {std::fwrite(m_buffer.data(), 1, m_buffer.size(), file) == m_buffer.size()};
+    if (std::fclose(file) != 0 or not written or std::rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+        std::cout << __func__ << ": error: could not write " << path << std::endl;
+        std::remove(temporary_path.c_str());
+    }
+}
+
+std::string Checkpointer::instance_key(const std::vector<primitives::space_t>& x
+    , const std::vector<primitives::space_t>& y)
+{
+    uint64_t hash {14695981039346656037ull}; // FNV-1a offset basis.
+    for (const auto* coordinates : {&x, &y})
+    {
+        for (auto c : *coordinates)
+        {
+            uint64_t bits {0};
+            std::memcpy(&bits, &c, std::min(sizeof(bits), sizeof(c)));
+            for (int byte {0}; byte < 8; ++byte)
+            {
+                hash ^= (bits >> (8 * byte)) & 0xff;
+                hash *= 1099511628211ull; // FNV-1a prime.
+            }
+        }
+    }
+    char hex[17] {};
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return std::to_string(x.size()) + "_" + hex;
+}
+
+std::string Checkpointer::latest(const std::string& directory, const std::string& instance_key)
+{
+    const auto prefix {"test_" + instance_key + "_"};
+    const std::string suffix {".txt"};
+    std::string best_path;
+    primitives::length_t best_length {0};
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        const auto name {entry.path().filename().string()};
+        if (name.size() <= prefix.size() + suffix.size()
+            or name.compare(0, prefix.size(), prefix) != 0
+            or name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+        {
+            continue;
+        }
+        primitives::length_t length {0};
+        const auto first {name.data() + prefix.size()};
+        const auto last {name.data() + name.size() - suffix.size()};
+        const auto result {std::from_chars(first, last, length)};
+        if (result.ec != std::errc() or result.ptr != last)
+        {
+            continue;
+        }
+        if (best_path.empty() or length < best_length)
+        {
+            best_path = entry.path().string();
+            best_length = length;
+        }
+    }
+    return best_path;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Writes tour checkpoints on a background thread.
+// offer() is called after every improvement. It snapshots the tour order only when
+//  at least save_period improvements and save_seconds have passed since the last
+//  checkpoint, and the writer is idle; otherwise the improvement is only counted.
+// A checkpoint is formatted into one buffer, written to a temporary file and
+//  renamed, so a checkpoint file is never partially written.
+// Files are named <directory>/test_<instance key>_<tour length>.txt, so the
+//  checkpoint with the smallest length is the latest one (see latest()).
+// The instance key is the point count and a hash of the coordinates, so instances
+//  with the same point count do not resume from each other's checkpoints.
+
+#include "Tour.h"
+#include "primitives.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Checkpointer
+{
+public:
+    // Creates directory if it does not exist.
+    Checkpointer(std::string directory, std::string instance_key, size_t save_period, double save_seconds);
+    ~Checkpointer();
+
+    void offer(const Tour& tour);
+    // Writes tour if it changed since the last checkpoint, and waits for all writes.
+    void flush(const Tour& tour);
+
+    // <point count>_<16 hex digit FNV-1a hash of the coordinate bits>.
+    static std::string instance_key(const std::vector<primitives::space_t>& x
+        , const std::vector<primitives::space_t>& y);
+    // Path of the checkpoint with the smallest length for instance_key; empty if none.
+    static std::string latest(const std::string& directory, const std::string& instance_key);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    const std::string m_directory;
+    const std::string m_instance_key;
+    const size_t m_save_period {1};
+    const std::chrono::duration<double> m_save_seconds;
+    bool m_enabled {true}; // false if the directory could not be created.
+
+    // search thread only.
+    size_t m_improvements {0}; // since the last checkpoint.
+    Clock::time_point m_last_save;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    bool m_pending {false}; // m_snapshot is waiting to be written.
+    bool m_writing {false};
+    bool m_exit {false};
+    std::vector<primitives::point_id_t> m_snapshot;
+    primitives::length_t m_snapshot_length {0};
+    std::string m_buffer; // writer thread only.
+    std::thread m_writer;
+
+    bool busy() const { return m_pending or m_writing; }
+    void save(const Tour& tour); // hands a snapshot to the writer; m_mutex must be held.
+    void write_loop();
+    void write(const std::vector<primitives::point_id_t>& order, primitives::length_t length);
+};
@@ -1,30 +1,222 @@
 #include "LengthMap.h"
 
+#include <algorithm> // min_element
+#include <cmath> // floor, sqrt
+#include <iostream>
+#include <utility> // move
+
 LengthMap::LengthMap(const std::vector<primitives::space_t>& x
-    , const std::vector<primitives::space_t>& y)
-    : m_x(x), m_y(y), m_lengths(x.size()) {}
+    , const std::vector<primitives::space_t>& y
+    , Cache cache
+    , size_t cache_size
+    , Storage storage)
+    : m_x(x), m_y(y), m_cache(cache), m_cache_size(cache_size)
+{
+    quantize(storage);
+    allocate_cache();
+}
+
+LengthMap::LengthMap(const LengthMap& shared, Cache cache, size_t cache_size)
+    : m_x(shared.m_x), m_y(shared.m_y), m_cache(cache), m_cache_size(cache_size)
+    , m_storage(shared.m_storage), m_exact(shared.m_exact)
+{
+    share(shared.m_quantized);
+    allocate_cache();
+}
+
+void LengthMap::allocate_cache()
+{
+    switch (m_cache)
+    {
+        case Cache::flat:
+        {
+            const size_t requested {m_cache_size == 0 ? constants::flat_length_cache_size : m_cache_size};
+            size_t entries {1};
+            int bits {0};
+            while (entries < requested)
+            {
+                entries <<= 1;
+                ++bits;
+            }
+            m_flat.resize(entries);
+            m_flat_mask = entries - 1;
+            m_flat_shift = 64 - std::max(bits, 1);
+            break;
+        }
+        case Cache::neighbor:
+        {
+            m_slots = m_cache_size == 0 ? constants::neighbor_length_slots : m_cache_size;
+            if (m_slots > std::numeric_limits<uint8_t>::max())
+            {
+                std::cout << __func__ << ": error: too many neighbor slots: " << m_slots << std::endl;
+                std::abort();
+            }
+            m_slot_points.resize(m_x.size() * m_slots, constants::invalid_point);
+            m_slot_lengths.resize(m_x.size() * m_slots);
+            m_slot_cursor.resize(m_x.size());
+            break;
+        }
+        default: break;
+    }
+}
 
-primitives::length_t LengthMap::compute_length(
-    primitives::point_id_t a, primitives::point_id_t b) const
+void LengthMap::quantize(Storage storage)
 {
-    auto dx = m_x[a] - m_x[b];
-    auto dy = m_y[a] - m_y[b];
-    auto exact = std::sqrt(dx * dx + dy * dy);
-    return exact + 0.5; // return type cast.
+    if (storage == Storage::double_precision or m_x.empty())
+    {
+        return;
+    }
+    const auto xmin {*std::min_element(std::cbegin(m_x), std::cend(m_x))};
+    const auto ymin {*std::min_element(std::cbegin(m_y), std::cend(m_y))};
+    auto quantized {std::make_shared<Quantized>()};
+    if (storage == Storage::int32)
+    {
+        constexpr primitives::space_t max_offset {1 << 26};
+        const auto xorigin {std::floor(xmin)};
+        const auto yorigin {std::floor(ymin)};
+        const auto integral = [max_offset](primitives::space_t offset)
+        {
+            return offset < max_offset and offset == std::floor(offset);
+        };
+        for (size_t i {0}; i < m_x.size(); ++i)
+        {
+            if (not integral(m_x[i] - xorigin) or not integral(m_y[i] - yorigin))
+            {
+                return;
+            }
+            quantized->ix.push_back(static_cast<int32_t>(m_x[i] - xorigin));
+            quantized->iy.push_back(static_cast<int32_t>(m_y[i] - yorigin));
+        }
+        m_storage = Storage::int32;
+        share(std::move(quantized));
+        return;
+    }
+    quantized->fx.reserve(m_x.size());
+    quantized->fy.reserve(m_y.size());
+    for (size_t i {0}; i < m_x.size(); ++i)
+    {
+        quantized->fx.push_back(static_cast<float>(m_x[i] - xmin));
+        quantized->fy.push_back(static_cast<float>(m_y[i] - ymin));
+        m_exact = m_exact and quantized->fx.back() == m_x[i] - xmin and quantized->fy.back() == m_y[i] - ymin;
+    }
+    m_storage = Storage::float32;
+    share(std::move(quantized));
 }
 
-primitives::length_t LengthMap::length(primitives::point_id_t a, primitives::point_id_t b)
+void LengthMap::share(std::shared_ptr<const Quantized> quantized)
 {
-    auto min {std::min(a, b)};
-    auto& lengths {m_lengths[min]};
-    auto max {std::max(a, b)};
-    auto it {lengths.find(max)};
-    if (it == std::cend(lengths))
+    m_quantized = std::move(quantized);
+    if (m_quantized)
     {
-        auto length {compute_length(min, max)};
-        lengths[max] = length;
-        return length;
+        m_ix = m_quantized->ix.data();
+        m_iy = m_quantized->iy.data();
+        m_fx = m_quantized->fx.data();
+        m_fy = m_quantized->fy.data();
     }
-    return it->second;
 }
 
+void LengthMap::lengths(primitives::point_id_t a
+    , const primitives::point_id_t* points
+    , size_t count
+    , primitives::length_t* lengths)
+{
+    m_squares.resize(count);
+    auto* squares {m_squares.data()};
+    // Same arithmetic as compute_length, so lengths are identical.
+    switch (m_storage)
+    {
+        case Storage::int32:
+        {
+            const int64_t ax {m_ix[a]};
+            const int64_t ay {m_iy[a]};
+            for (size_t k {0}; k < count; ++k)
+            {
+                const int64_t dx {ax - m_ix[points[k]]};
+                const int64_t dy {ay - m_iy[points[k]]};
+                squares[k] = static_cast<double>(dx * dx + dy * dy);
+            }
+            break;
+        }
+        case Storage::float32:
+        {
+            const double ax {m_fx[a]};
+            const double ay {m_fy[a]};
+            for (size_t k {0}; k < count; ++k)
+            {
+                const double dx {ax - m_fx[points[k]]};
+                const double dy {ay - m_fy[points[k]]};
+                squares[k] = dx * dx + dy * dy;
+            }
+            break;
+        }
+        default:
+        {
+            const auto ax {m_x[a]};
+            const auto ay {m_y[a]};
+            for (size_t k {0}; k < count; ++k)
+            {
+                const auto dx {ax - m_x[points[k]]};
+                const auto dy {ay - m_y[points[k]]};
+                squares[k] = dx * dx + dy * dy;
+            }
+            break;
+        }
+    }
+    for (size_t k {0}; k < count; ++k)
+    {
+        lengths[k] = std::sqrt(squares[k]) + 0.5;
+    }
+    if constexpr (constants::search_stats)
+    {
+        m_misses += count;
+    }
+}
+
+primitives::length_t LengthMap::flat_length(primitives::point_id_t a, primitives::point_id_t b)
+{
+    const auto min {std::min(a, b)};
+    const auto max {std::max(a, b)};
+    const pair_key_t key {(static_cast<pair_key_t>(min) << 32) | max};
+    constexpr pair_key_t fibonacci_multiplier {0x9E3779B97F4A7C15};
+    const pair_key_t home {(key * fibonacci_multiplier) >> m_flat_shift};
+    for (size_t probe {0}; probe < constants::flat_length_cache_probes; ++probe)
+    {
+        auto& entry {m_flat[(home + probe) & m_flat_mask]};
+        if (entry.key == key)
+        {
+            count(true);
+            return entry.length;
+        }
+        if (entry.key == empty_key)
+        {
+            entry.key = key;
+            entry.length = compute_length(min, max);
+            return entry.length;
+        }
+    }
+    auto& entry {m_flat[home & m_flat_mask]};
+    entry.key = key;
+    entry.length = compute_length(min, max);
+    return entry.length;
+}
+
+primitives::length_t LengthMap::neighbor_length(primitives::point_id_t a, primitives::point_id_t b)
+{
+    const auto min {std::min(a, b)};
+    const auto max {std::max(a, b)};
+    const auto first_slot {static_cast<size_t>(min) * m_slots};
+    for (size_t slot {first_slot}; slot < first_slot + m_slots; ++slot)
+    {
+        if (m_slot_points[slot] == max)
+        {
+            count(true);
+            return m_slot_lengths[slot];
+        }
+    }
+    auto& cursor {m_slot_cursor[min]};
+    const auto slot {first_slot + cursor};
+    cursor = (cursor + 1) % m_slots;
+    m_slot_points[slot] = max;
+    m_slot_lengths[slot] = compute_length(min, max);
+    return m_slot_lengths[slot];
+}
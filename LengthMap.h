@@ -1,19 +1,70 @@
 #pragma once
 
+// Rounded Euclidean lengths between points.
+// The cache policy is chosen at construction:
+//  none: lengths are computed from the coordinates on every query.
+//  flat: bounded open-addressing table keyed by point pair;
+//   when all probe slots are taken, the home slot is overwritten.
+//  neighbor: a fixed number of slots per point (the smaller id of the pair);
+//   slots are replaced round-robin.
+// Caches never grow after construction.
+// If constants::search_stats, cache hits and misses (computed lengths) are counted.
+// Lengths are computed from a copy of the coordinates in the chosen storage:
+//  double: the input coordinates.
+//  int32: offsets from the smallest (floored) coordinate; only used if all offsets are
+//   integers below 2^26, where the squared lengths are exact in both int64 and double,
+//   so lengths are the same as with double storage. Otherwise double storage is used.
+//  float32: offsets from the smallest coordinate. Lengths are the same as with double
+//   storage if every offset is a float (e.g. integers below 2^24); otherwise they are
+//   computed from the nearest floats.
+// The narrow copies are extra memory (8 bytes per point): the double coordinates are
+//  only referenced here, but the quadtree and Tour still use them. What shrinks is the
+//  working set read by length computations, from 16 to 8 bytes per point.
+// The narrow copies are read-only, so maps constructed from another map (e.g. per thread)
+//  share them and only have their own cache.
+// lengths() computes a batch of lengths from one point, bypassing the cache;
+//  it is used to precompute candidate lengths (CandidateSet::compute_lengths).
+
+#include "constants.h"
 #include "primitives.h"
 
 #include <algorithm> // min, max
 #include <cmath> // sqrt
-#include <unordered_map>
+#include <cstdint>
+#include <memory> // shared_ptr
 #include <vector>
 
 class LengthMap
 {
 public:
+    enum class Cache { none, flat, neighbor };
+    enum class Storage { double_precision, int32, float32 };
+
+    // cache_size is the number of table entries (flat) or slots per point (neighbor);
+    //  0 selects the default from constants.h.
     LengthMap(const std::vector<primitives::space_t>& x
-        , const std::vector<primitives::space_t>& y);
+        , const std::vector<primitives::space_t>& y
+        , Cache cache = Cache::none
+        , size_t cache_size = 0
+        , Storage storage = Storage::double_precision);
+    // Same coordinates and storage as shared, which it shares, with its own empty cache.
+    LengthMap(const LengthMap& shared, Cache cache, size_t cache_size);
+
+    primitives::length_t length(primitives::point_id_t a, primitives::point_id_t b)
+    {
+        switch (m_cache)
+        {
+            case Cache::flat: return flat_length(a, b);
+            case Cache::neighbor: return neighbor_length(a, b);
+            default: return compute_length(a, b);
+        }
+    }
 
-    primitives::length_t length(primitives::point_id_t a, primitives::point_id_t b);
+    // Writes the lengths from a to count points, the same as length(a, point).
+    void lengths(primitives::point_id_t a
+        , const primitives::point_id_t* points
+        , size_t count
+        , primitives::length_t* lengths);
 
     const std::vector<primitives::space_t>& x() const { return m_x; }
     const std::vector<primitives::space_t>& y() const { return m_y; }
@@ -21,10 +72,97 @@ public:
     primitives::space_t x(primitives::point_id_t i) const { return m_x[i]; }
     primitives::space_t y(primitives::point_id_t i) const { return m_y[i]; }
 
+    Cache cache() const { return m_cache; }
+    // As passed to the constructor, so an equivalent map can be constructed.
+    size_t cache_size() const { return m_cache_size; }
+    // Storage in use; double_precision if int32 was requested but not exact.
+    Storage storage() const { return m_storage; }
+    // If float32 storage reproduces every double length.
+    bool exact() const { return m_exact; }
+
+    // Always 0 unless constants::search_stats.
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
 private:
+    using pair_key_t = uint64_t;
+    static constexpr pair_key_t empty_key {std::numeric_limits<pair_key_t>::max()};
+    struct FlatEntry
+    {
+        pair_key_t key {empty_key};
+        primitives::length_t length {0};
+    };
+
     const std::vector<primitives::space_t>& m_x;
     const std::vector<primitives::space_t>& m_y;
-    std::vector<std::unordered_map<primitives::point_id_t, primitives::length_t>> m_lengths;
+    const Cache m_cache {Cache::none};
+    const size_t m_cache_size {0};
+    // Narrow coordinate copies, shared by maps constructed from this one.
+    struct Quantized
+    {
+        std::vector<int32_t> ix;
+        std::vector<int32_t> iy;
+        std::vector<float> fx;
+        std::vector<float> fy;
+    };
+
+    Storage m_storage {Storage::double_precision};
+    bool m_exact {true};
+    std::shared_ptr<const Quantized> m_quantized;
+    // Data of m_quantized, for length computations.
+    const int32_t* m_ix {nullptr};
+    const int32_t* m_iy {nullptr};
+    const float* m_fx {nullptr};
+    const float* m_fy {nullptr};
+    uint64_t m_hits {0};
+    uint64_t m_misses {0};
+    std::vector<double> m_squares; // squared lengths of a lengths() batch.
+
+    // flat cache.
+    std::vector<FlatEntry> m_flat;
+    pair_key_t m_flat_mask {0};
+    int m_flat_shift {0}; // for multiplicative hashing.
+
+    // neighbor cache.
+    size_t m_slots {0};
+    std::vector<primitives::point_id_t> m_slot_points;
+    std::vector<primitives::length_t> m_slot_lengths;
+    std::vector<uint8_t> m_slot_cursor; // next slot to replace.
 
-    primitives::length_t compute_length(primitives::point_id_t a, primitives::point_id_t b) const;
+    void count(bool hit)
+    {
+        if constexpr (constants::search_stats)
+        {
+            ++(hit ? m_hits : m_misses);
+        }
+    }
+    primitives::length_t compute_length(primitives::point_id_t a, primitives::point_id_t b)
+    {
+        count(false);
+        switch (m_storage)
+        {
+            case Storage::int32:
+            {
+                const int64_t dx {m_ix[a] - m_ix[b]};
+                const int64_t dy {m_iy[a] - m_iy[b]};
+                return std::sqrt(static_cast<double>(dx * dx + dy * dy)) + 0.5;
+            }
+            case Storage::float32:
+            {
+                const double dx {static_cast<double>(m_fx[a]) - m_fx[b]};
+                const double dy {static_cast<double>(m_fy[a]) - m_fy[b]};
+                return std::sqrt(dx * dx + dy * dy) + 0.5;
+            }
+            default: break;
+        }
+        auto dx = m_x[a] - m_x[b];
+        auto dy = m_y[a] - m_y[b];
+        auto exact = std::sqrt(dx * dx + dy * dy);
+        return exact + 0.5; // return type cast.
+    }
+    void quantize(Storage);
+    void share(std::shared_ptr<const Quantized>);
+    void allocate_cache();
+    primitives::length_t flat_length(primitives::point_id_t a, primitives::point_id_t b);
+    primitives::length_t neighbor_length(primitives::point_id_t a, primitives::point_id_t b);
 };
@@ -0,0 +1,148 @@
+#include "ThreadPool.h"
+
+#include <algorithm> // max, min
+
+namespace {
+
+uint64_t pack(uint64_t begin, uint64_t end)
+{
+    return (begin << 32) | end;
+}
+
+uint64_t range_begin(uint64_t bounds)
+{
+    return bounds >> 32;
+}
+
+uint64_t range_end(uint64_t bounds)
+{
+    return bounds & 0xFFFFFFFF;
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t workers) : m_ranges(std::max(workers, static_cast<size_t>(1)))
+{
+    for (size_t worker {1}; worker < m_ranges.size(); ++worker)
+    {
+        m_threads.emplace_back(&ThreadPool::thread_loop, this, worker);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+    m_start.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::run(size_t count, const Task& task)
+{
+    for (size_t offset {0}; offset < count; offset += max_chunk)
+    {
+        run_chunk(offset, std::min(count - offset, static_cast<size_t>(max_chunk)), task);
+    }
+}
+
+void ThreadPool::run_chunk(size_t offset, size_t count, const Task& task)
+{
+    const auto workers {m_ranges.size()};
+    for (size_t worker {0}; worker < workers; ++worker)
+    {
+        const auto begin {count * worker / workers};
+        const auto end {count * (worker + 1) / workers};
+        m_ranges[worker].bounds.store(pack(begin, end), std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_offset = offset;
+        m_running = m_threads.size();
+        ++m_generation;
+    }
+    m_start.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_running == 0; });
+    m_task = nullptr;
+}
+
+void ThreadPool::thread_loop(size_t worker)
+{
+    uint64_t generation {0};
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, generation] { return m_exit or m_generation != generation; });
+            if (m_exit)
+            {
+                return;
+            }
+            generation = m_generation;
+        }
+        work(worker);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_running;
+        }
+        m_done.notify_one();
+    }
+}
+
+void ThreadPool::work(size_t worker)
+{
+    size_t index {0};
+    do
+    {
+        while (pop(worker, index))
+        {
+            (*m_task)(worker, m_offset + index);
+        }
+    } while (steal(worker));
+}
+
+bool ThreadPool::pop(size_t worker, size_t& index)
+{
+    auto& bounds {m_ranges[worker].bounds};
+    auto current {bounds.load(std::memory_order_acquire)};
+    while (range_begin(current) < range_end(current))
+    {
+        if (bounds.compare_exchange_weak(current, pack(range_begin(current) + 1, range_end(current))
+            , std::memory_order_acq_rel))
+        {
+            index = range_begin(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Moves the back half of another worker's range into this worker's (empty) range.
+bool ThreadPool::steal(size_t worker)
+{
+    const auto workers {m_ranges.size()};
+    for (size_t offset {1}; offset < workers; ++offset)
+    {
+        auto& victim {m_ranges[(worker + offset) % workers].bounds};
+        auto current {victim.load(std::memory_order_acquire)};
+        while (range_begin(current) < range_end(current))
+        {
+            const auto begin {range_begin(current)};
+            const auto end {range_end(current)};
+            const auto middle {end - std::max((end - begin) / 2, static_cast<uint64_t>(1))};
+            if (victim.compare_exchange_weak(current, pack(begin, middle), std::memory_order_acq_rel))
+            {
+                m_ranges[worker].bounds.store(pack(middle, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
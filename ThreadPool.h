@@ -0,0 +1,58 @@
+#pragma once
+
+// Fixed-size pool for data-parallel loops.
+// run() splits task indices evenly into one range per worker; a worker takes
+//  indices from the front of its own range and, when that is empty, steals
+//  the back half of another worker's range.
+// The calling thread is worker 0, so a pool of size 1 starts no threads.
+// Ranges are packed into one word with 32-bit bounds, so larger counts are run
+//  as consecutive chunks of at most max_chunk indices.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory> // unique_ptr
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    using Task = std::function<void(size_t worker, size_t index)>;
+
+    explicit ThreadPool(size_t workers);
+    ~ThreadPool();
+
+    size_t size() const { return m_ranges.size(); }
+
+    // Calls task(worker, index) for every index in [0, count); returns when all calls have returned.
+    void run(size_t count, const Task& task);
+
+private:
+    static constexpr uint64_t max_chunk {0xFFFFFFFF};
+
+    // Packed [begin, end) index range, relative to m_offset; begin in the high 32 bits.
+    struct alignas(64) Range
+    {
+        std::atomic<uint64_t> bounds {0};
+    };
+
+    std::vector<Range> m_ranges;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    const Task* m_task {nullptr};
+    size_t m_offset {0}; // first index of the current chunk.
+    uint64_t m_generation {0};
+    size_t m_running {0}; // worker threads (excluding the caller) still in the current run.
+    bool m_exit {false};
+
+    void run_chunk(size_t offset, size_t count, const Task& task);
+    void thread_loop(size_t worker);
+    void work(size_t worker);
+    bool pop(size_t worker, size_t& index);
+    bool steal(size_t worker);
+};
@@ -1,25 +1,38 @@
 #include "Tour.h"
 
+#include <algorithm> // max, min, reverse, sort
+#include <cmath> // sqrt
+
 Tour::Tour(const std::vector<primitives::point_id_t>& initial_tour
     , LengthMap* length_map)
 : m_length_map(length_map)
-, m_adjacents(initial_tour.size(), {constants::invalid_point, constants::invalid_point})
-, m_next(initial_tour.size(), constants::invalid_point)
-, m_sequence(initial_tour.size(), constants::invalid_point)
-{
-    reset_adjacencies(initial_tour);
-    update_next();
-}
-
-primitives::point_id_t Tour::sequence(primitives::point_id_t i, primitives::point_id_t start) const
+, m_parent(initial_tour.size(), constants::invalid_point)
+, m_rank(initial_tour.size(), 0)
+, m_links(initial_tour.size(), {constants::invalid_point, constants::invalid_point})
 {
-    auto start_sequence {m_sequence[start]};
-    auto raw_sequence {m_sequence[i]};
-    if (raw_sequence < start_sequence)
+    const auto point_count {static_cast<primitives::point_id_t>(initial_tour.size())};
+    m_segment_size = std::max(static_cast<primitives::point_id_t>(std::sqrt(point_count) + 1)
+        , constants::min_tour_segment_size);
+    for (primitives::point_id_t first {0}; first < point_count; first += m_segment_size)
     {
-        raw_sequence += m_sequence.size();
+        const auto s {allocate_segment()};
+        auto& segment {m_segments[s]};
+        const auto last {std::min<primitives::point_id_t>(first + m_segment_size, point_count)};
+        segment.first = initial_tour[first];
+        segment.last = initial_tour[last - 1];
+        segment.size = last - first;
+        for (auto i {first}; i < last; ++i)
+        {
+            const auto p {initial_tour[i]};
+            m_parent[p] = s;
+            m_rank[p] = i - first;
+            m_links[p][0] = i > first ? initial_tour[i - 1] : constants::invalid_point;
+            m_links[p][1] = i + 1 < last ? initial_tour[i + 1] : constants::invalid_point;
+        }
+        m_order.push_back(s);
     }
-    return raw_sequence - start_sequence;
+    renumber_segments();
+    m_length = compute_length();
 }
 
 Box Tour::search_box(primitives::point_id_t i, primitives::length_t radius) const
@@ -34,6 +47,15 @@ Box Tour::search_box(primitives::point_id_t i, primitives::length_t radius) cons
     return box;
 }
 
+Circle Tour::search_circle(primitives::point_id_t i, primitives::length_t radius) const
+{
+    Circle circle;
+    circle.x = m_length_map->x(i);
+    circle.y = m_length_map->y(i);
+    circle.radius = radius;
+    return circle;
+}
+
 Box Tour::search_box_next(primitives::point_id_t i) const
 {
     return search_box(i, length(i) + 1);
@@ -44,38 +66,10 @@ Box Tour::search_box_prev(primitives::point_id_t i) const
     return search_box(i, prev_length(i) + 1);
 }
 
-void Tour::reset_adjacencies(const std::vector<primitives::point_id_t>& initial_tour)
-{
-    auto prev = initial_tour.back();
-    for (auto p : initial_tour)
-    {
-        create_adjacency(p, prev);
-        prev = p;
-    }
-}
-
-primitives::point_id_t Tour::prev(primitives::point_id_t i) const
-{
-    const auto next {m_next[i]};
-    if (m_adjacents[i][0] == next)
-    {
-        return m_adjacents[i][1];
-    }
-    else if (m_adjacents[i][1] == next)
-    {
-        return m_adjacents[i][0];
-    }
-    else
-    {
-        std::cout << __func__ << ": error: could not determine previous point." << std::endl;
-        std::abort();
-    }
-}
-
-primitives::length_t Tour::length() const
+primitives::length_t Tour::compute_length() const
 {
     primitives::length_t sum {0};
-    for (primitives::point_id_t i {0}; i < m_next.size(); ++i)
+    for (primitives::point_id_t i {0}; i < size(); ++i)
     {
         sum += length(i);
     }
@@ -89,7 +83,7 @@ primitives::length_t Tour::prev_length(primitives::point_id_t i) const
 
 primitives::length_t Tour::length(primitives::point_id_t i) const
 {
-    return m_length_map->length(i, m_next[i]);
+    return m_length_map->length(i, next(i));
 }
 
 std::vector<primitives::point_id_t> Tour::order() const
@@ -97,12 +91,13 @@ std::vector<primitives::point_id_t> Tour::order() const
     constexpr primitives::point_id_t start {0};
     primitives::point_id_t current {start};
     std::vector<primitives::point_id_t> ordered_points;
+    ordered_points.reserve(size());
     primitives::point_id_t count {0};
     do
     {
         ordered_points.push_back(current);
-        current = m_next[current];
-        if (count > m_next.size())
+        current = next(current);
+        if (count > size())
         {
             std::cout << __func__ << ": error: too many traversals." << std::endl;
             std::abort();
@@ -112,133 +107,370 @@ std::vector<primitives::point_id_t> Tour::order() const
     return ordered_points;
 }
 
-void Tour::forward_swap(const std::vector<primitives::point_id_t> swap, bool cyclic_first)
+void Tour::forward_swap(const std::vector<primitives::point_id_t>& swap, bool cyclic_first, bool reversed)
 {
-    // Use of prev() should precede use of break_adjacency().
-    primitives::point_id_t last {prev(swap.front())};
-    if (cyclic_first)
-    {
-        last = m_next[swap.front()];
-    }
-    std::vector<primitives::point_id_t> prevs;
-    auto it = ++std::cbegin(swap);
-    while (it != std::cend(swap))
-    {
-        prevs.push_back(prev(*it));
-        ++it;
-    }
-    // for each point p in swap, edge (p, prev(p)) is deleted.
+    // swap is in the orientation given by reversed; succ and pred traverse it.
+    // for each point p in swap, edge (p, pred(p)) is deleted
+    //  (except for the first point if cyclic_first, where edge (p, succ(p)) is deleted).
+    const auto succ = [this, reversed](primitives::point_id_t i) { return reversed ? prev(i) : next(i); };
+    const auto pred = [this, reversed](primitives::point_id_t i) { return reversed ? next(i) : prev(i); };
+    // removed edge (p, succ(p)) is stored by its tail in tour orientation.
+    const auto tail = [reversed, &succ](primitives::point_id_t p) { return reversed ? succ(p) : p; };
+    const primitives::point_id_t last {cyclic_first ? succ(swap.front()) : pred(swap.front())};
+    const primitives::point_id_t first_start {cyclic_first ? swap.front() : last};
+    m_removed.clear();
+    m_removed.push_back(tail(first_start));
     for (size_t i {1}; i < swap.size(); ++i)
     {
-        break_adjacency(prevs[i - 1], swap[i]);
-    }
-    if (cyclic_first)
-    {
-        break_adjacency(swap.front());
-    }
-    else
-    {
-        break_adjacency(swap.front(), last);
+        m_removed.push_back(tail(pred(swap[i])));
     }
-    create_adjacency(swap[0], swap[1]);
+    m_added.clear();
+    m_added.push_back({swap[0], swap[1]});
     for (size_t i {2}; i < swap.size(); ++i)
     {
-        create_adjacency(prevs[i - 2], swap[i]);
+        m_added.push_back({pred(swap[i - 1]), swap[i]});
     }
-    create_adjacency(prevs.back(), last);
-    update_next();
+    m_added.push_back({pred(swap.back()), last});
+    reconnect();
 }
 
 void Tour::move(primitives::point_id_t a, primitives::point_id_t b)
 {
-    break_adjacency(a);
-    break_adjacency(b);
-    create_adjacency(a, b);
-    create_adjacency(m_next[a], m_next[b]);
-    update_next();
+    m_removed = {a, b};
+    m_added = {{a, b}, {next(a), next(b)}};
+    reconnect();
 }
 
 void Tour::vmove(primitives::point_id_t v, primitives::point_id_t n)
 {
     const auto prev_v {prev(v)};
-    break_adjacency(v);
-    break_adjacency(prev_v);
-    break_adjacency(n);
-    create_adjacency(v, n);
-    create_adjacency(v, m_next[n]);
-    create_adjacency(prev_v, m_next[v]);
-    update_next();
+    m_removed = {prev_v, v, n};
+    m_added = {{v, n}, {v, next(n)}, {prev_v, next(v)}};
+    reconnect();
 }
 
-void Tour::update_next()
+void Tour::segment_move(primitives::point_id_t first, primitives::point_id_t last
+    , primitives::point_id_t a, bool reverse)
 {
-    primitives::point_id_t current {0};
-    m_next[current] = m_adjacents[current].front();
-    primitives::point_id_t sequence {0};
-    do
+    const auto before {prev(first)};
+    const auto after {next(last)};
+    const auto a_next {next(a)};
+    m_removed = {before, last, a};
+    m_added = {{before, after}
+        , {a, reverse ? last : first}
+        , {reverse ? first : last, a_next}};
+    reconnect();
+}
+
+void Tour::double_bridge(primitives::point_id_t a, primitives::point_id_t b
+    , primitives::point_id_t c, primitives::point_id_t d)
+{
+    m_removed = {a, b, c, d};
+    m_added = {{a, next(c)}, {d, next(b)}, {c, next(a)}, {b, next(d)}};
+    reconnect();
+}
+
+void Tour::journal(bool enable)
+{
+    m_journaling = enable;
+    m_journal_edges.clear();
+    m_journal_moves.clear();
+}
+
+void Tour::rollback()
+{
+    const bool journaling {m_journaling};
+    m_journaling = false;
+    auto end {m_journal_edges.size()};
+    for (auto move {m_journal_moves.crbegin()}; move != m_journal_moves.crend(); ++move)
     {
-        auto prev = current;
-        m_sequence[current] = sequence++;
-        current = m_next[current];
-        m_next[current] = get_other(current, prev);
-    } while (current != 0); // tour cycle condition.
+        const auto [removed, added] {*move};
+        const auto begin {end - removed - added};
+        // The added edges are removed, in the current orientation.
+        m_removed.clear();
+        for (auto k {begin + removed}; k < end; ++k)
+        {
+            const auto [p, q] {m_journal_edges[k]};
+            m_removed.push_back(next(p) == q ? p : q);
+        }
+        m_added.assign(std::cbegin(m_journal_edges) + begin, std::cbegin(m_journal_edges) + begin + removed);
+        reconnect();
+        end = begin;
+    }
+    journal(journaling);
 }
 
-primitives::point_id_t Tour::get_other(primitives::point_id_t point, primitives::point_id_t adjacent) const
+void Tour::reconnect()
 {
-    const auto& a = m_adjacents[point];
-    if (a.front() == adjacent)
+    if (m_journaling)
     {
-        return a.back();
+        for (auto p : m_removed)
+        {
+            m_journal_edges.push_back({p, next(p)});
+        }
+        m_journal_edges.insert(std::end(m_journal_edges), std::cbegin(m_added), std::cend(m_added));
+        m_journal_moves.push_back({m_removed.size(), m_added.size()});
     }
-    else
+    m_changed.clear();
+    for (auto p : m_removed)
+    {
+        m_changed.push_back(p);
+        m_changed.push_back(next(p));
+        m_length -= m_length_map->length(p, next(p));
+    }
+    for (const auto& edge : m_added)
+    {
+        m_length += m_length_map->length(edge.first, edge.second);
+    }
+    // Pieces are the tour paths between removed edges.
+    // Piece j starts after removed edge j - 1 and ends at removed edge j.
+    std::sort(std::begin(m_removed), std::end(m_removed)
+        , [this](auto a, auto b) { return position(a) < position(b); });
+    const auto piece_count {static_cast<primitives::point_id_t>(m_removed.size())};
+    m_piece_heads.clear();
+    for (primitives::point_id_t j {0}; j < piece_count; ++j)
     {
-        return a.front();
+        m_piece_heads.push_back(next(m_removed[(j + piece_count - 1) % piece_count]));
+    }
+    for (auto head : m_piece_heads)
+    {
+        split_before(head);
+    }
+
+    // Each piece has a head slot (2 * j) and a tail slot (2 * j + 1),
+    //  which added edges connect.
+    const auto slot_count {2 * piece_count};
+    m_slot_partners.assign(slot_count, constants::invalid_point);
+    for (const auto& edge : m_added)
+    {
+        const auto a {find_slot(edge.first)};
+        m_slot_partners[a] = slot_count; // reserved.
+        const auto b {find_slot(edge.second)};
+        m_slot_partners[a] = b;
+        m_slot_partners[b] = a;
+    }
+
+    // Traverse pieces in new tour order, starting with piece 0 in its current orientation.
+    m_pieces.clear();
+    m_pieces.push_back({0, false});
+    primitives::point_id_t exit_slot {1};
+    while (true)
+    {
+        const auto entry_slot {m_slot_partners[exit_slot]};
+        const auto piece {entry_slot / 2};
+        if (entry_slot >= slot_count or piece == 0 or m_pieces.size() > piece_count)
+        {
+            break;
+        }
+        const bool reversed {entry_slot % 2 == 1};
+        m_pieces.push_back({piece, reversed});
+        exit_slot = reversed ? entry_slot - 1 : entry_slot + 1;
+    }
+    if (m_pieces.size() != piece_count)
+    {
+        std::cout << __func__ << ": error: reconnection does not produce a single tour." << std::endl;
+        std::abort();
+    }
+
+    // Each piece is now a run of whole segments in m_order.
+    m_new_order.clear();
+    for (const auto& piece : m_pieces)
+    {
+        const auto first_segment {m_parent[m_piece_heads[piece.first]]};
+        const auto last_segment {m_parent[m_removed[piece.first]]};
+        const auto run_begin {m_new_order.size()};
+        auto order {m_segments[first_segment].order};
+        while (true)
+        {
+            const auto s {m_order[order]};
+            m_new_order.push_back(s);
+            if (s == last_segment)
+            {
+                break;
+            }
+            order = order + 1u == m_order.size() ? 0u : order + 1u;
+        }
+        if (piece.second)
+        {
+            std::reverse(std::begin(m_new_order) + run_begin, std::end(m_new_order));
+            for (auto it {std::cbegin(m_new_order) + run_begin}; it != std::cend(m_new_order); ++it)
+            {
+                m_segments[*it].reversed = not m_segments[*it].reversed;
+            }
+        }
+    }
+    std::swap(m_order, m_new_order);
+    merge_small_segments();
+    renumber_segments();
+    if (constants::verify_tour_length and m_length != compute_length())
+    {
+        std::cout << __func__ << ": error: tracked tour length " << m_length
+            << " does not match computed length " << compute_length() << std::endl;
+        std::abort();
     }
 }
 
-void Tour::create_adjacency(primitives::point_id_t point1, primitives::point_id_t point2)
+primitives::point_id_t Tour::find_slot(primitives::point_id_t point) const
 {
-    fill_adjacent(point1, point2);
-    fill_adjacent(point2, point1);
+    for (primitives::point_id_t j {0}; j < m_piece_heads.size(); ++j)
+    {
+        if (m_piece_heads[j] == point and m_slot_partners[2 * j] == constants::invalid_point)
+        {
+            return 2 * j;
+        }
+        if (m_removed[j] == point and m_slot_partners[2 * j + 1] == constants::invalid_point)
+        {
+            return 2 * j + 1;
+        }
+    }
+    std::cout << __func__ << ": error: added edge endpoint " << point
+        << " is not a free endpoint of a removed edge." << std::endl;
+    std::abort();
 }
 
-void Tour::fill_adjacent(primitives::point_id_t point, primitives::point_id_t new_adjacent)
+// Makes i the first point (in tour orientation) of its segment.
+void Tour::split_before(primitives::point_id_t i)
 {
-    if (m_adjacents[point].front() == constants::invalid_point)
+    const auto s {m_parent[i]};
+    if (i == head(m_segments[s]))
     {
-        m_adjacents[point].front() = new_adjacent;
+        return;
     }
-    else if (m_adjacents[point].back() == constants::invalid_point)
+    const auto t {allocate_segment()};
+    auto& segment {m_segments[s]};
+    auto& split {m_segments[t]};
+    const auto offset {segment.offset};
+    // Internal cut between left_last and right_first.
+    const auto left_last {segment.reversed ? i : m_links[i][0]};
+    const auto right_first {m_links[left_last][1]};
+    const auto left_size {static_cast<primitives::point_id_t>(m_rank[left_last] - m_rank[segment.first] + 1)};
+    const auto right_size {segment.size - left_size};
+    // Move the smaller part to the new segment.
+    const bool move_right {right_size <= left_size};
+    split.reversed = segment.reversed;
+    if (move_right)
     {
-        m_adjacents[point].back() = new_adjacent;
+        split.first = right_first;
+        split.last = segment.last;
+        split.size = right_size;
+        segment.last = left_last;
+        segment.size = left_size;
     }
     else
     {
-        std::cout << __func__ << ": error: no available slot for new adjacent." << std::endl;
-        std::cout << point << " -> " << new_adjacent << std::endl;
-        std::abort();
+        split.first = segment.first;
+        split.last = left_last;
+        split.size = left_size;
+        segment.first = right_first;
+        segment.size = right_size;
+    }
+    auto p {split.first};
+    for (primitives::point_id_t k {0}; k < split.size; ++k)
+    {
+        m_parent[p] = t;
+        p = m_links[p][1];
+    }
+    // The left part comes first in tour orientation unless reversed.
+    const bool split_first {move_right == segment.reversed};
+    auto& first {split_first ? split : segment};
+    auto& second {split_first ? segment : split};
+    first.offset = offset;
+    second.offset = offset + first.size;
+    const auto insert_order {split_first ? segment.order : segment.order + 1u};
+    m_order.insert(std::begin(m_order) + insert_order, t);
+    for (auto order {insert_order}; order < m_order.size(); ++order)
+    {
+        m_segments[m_order[order]].order = order;
     }
 }
 
-void Tour::break_adjacency(primitives::point_id_t i)
+primitives::point_id_t Tour::allocate_segment()
 {
-    break_adjacency(i, m_next[i]);
+    if (m_free_segments.empty())
+    {
+        m_segments.emplace_back();
+        return m_segments.size() - 1;
+    }
+    const auto s {m_free_segments.back()};
+    m_free_segments.pop_back();
+    m_segments[s] = Segment();
+    return s;
+}
+
+// Moves all points of source into destination.
+// If at_tail, source follows destination in tour order; otherwise it precedes it.
+void Tour::absorb(primitives::point_id_t destination, primitives::point_id_t source, bool at_tail)
+{
+    auto& d {m_segments[destination]};
+    const auto& s {m_segments[source]};
+    // Points are attached at the tour tail (or head) of destination,
+    //  which is the internal last (or first) point unless destination is reversed.
+    const bool attach_internal_last {at_tail != d.reversed};
+    // Traverse source starting from the point adjacent to destination.
+    const bool source_forward {at_tail != s.reversed};
+    auto p {at_tail ? head(s) : tail(s)};
+    for (primitives::point_id_t k {0}; k < s.size; ++k)
+    {
+        const auto following {m_links[p][source_forward ? 1 : 0]};
+        if (attach_internal_last)
+        {
+            m_links[d.last][1] = p;
+            m_links[p][0] = d.last;
+            m_rank[p] = m_rank[d.last] + 1;
+            d.last = p;
+        }
+        else
+        {
+            m_links[d.first][0] = p;
+            m_links[p][1] = d.first;
+            m_rank[p] = m_rank[d.first] - 1;
+            d.first = p;
+        }
+        m_parent[p] = destination;
+        p = following;
+    }
+    d.size += s.size;
+    m_free_segments.push_back(source);
 }
 
-void Tour::break_adjacency(primitives::point_id_t point1, primitives::point_id_t point2)
+// Merges adjacent segments whose combined size does not exceed m_segment_size,
+//  so that the number of segments stays O(n / m_segment_size).
+void Tour::merge_small_segments()
 {
-    vacate_adjacent_slot(point1, point2, 0);
-    vacate_adjacent_slot(point1, point2, 1);
-    vacate_adjacent_slot(point2, point1, 0);
-    vacate_adjacent_slot(point2, point1, 1);
+    m_new_order.clear();
+    for (auto s : m_order)
+    {
+        if (not m_new_order.empty())
+        {
+            const auto previous {m_new_order.back()};
+            if (m_segments[previous].size + m_segments[s].size <= m_segment_size)
+            {
+                if (m_segments[s].size <= m_segments[previous].size)
+                {
+                    absorb(previous, s, true);
+                }
+                else
+                {
+                    absorb(s, previous, false);
+                    m_new_order.back() = s;
+                }
+                continue;
+            }
+        }
+        m_new_order.push_back(s);
+    }
+    std::swap(m_order, m_new_order);
 }
 
-void Tour::vacate_adjacent_slot(primitives::point_id_t point, primitives::point_id_t adjacent, int slot)
+void Tour::renumber_segments()
 {
-    if (m_adjacents[point][slot] == adjacent)
+    primitives::point_id_t offset {0};
+    for (primitives::point_id_t order {0}; order < m_order.size(); ++order)
     {
-        m_adjacents[point][slot] = constants::invalid_point;
+        auto& segment {m_segments[m_order[order]]};
+        segment.order = order;
+        segment.offset = offset;
+        offset += segment.size;
     }
 }
 
@@ -250,18 +482,24 @@ void Tour::validate() const
     do
     {
         ++visited;
-        if (visited > m_next.size())
+        const auto following {next(current)};
+        if (visited > size() or prev(following) != current
+            or sequence(following, current) != 1 % size())
         {
             std::cout << __func__ << ": error: invalid tour." << std::endl;
             std::abort();
         }
-        current = m_next[current];
+        current = following;
     } while(current != start);
-    if (visited != m_next.size())
+    if (visited != size())
     {
         std::cout << __func__ << ": error: invalid tour." << std::endl;
         std::abort();
     }
+    if (m_length != compute_length())
+    {
+        std::cout << __func__ << ": error: tracked tour length does not match computed length." << std::endl;
+        std::abort();
+    }
     std::cout << __func__ << ": success: tour valid." << std::endl;
 }
-
@@ -1,35 +1,94 @@
 #pragma once
 
+// Tour stored as a two-level doubly-linked list.
+// Consecutive tour points are grouped into segments of at most about sqrt(n) points.
+// Each segment links its points in an internal orientation, numbers them with
+//  consecutive ranks, and has a reversal bit and a tour position offset,
+//  so next, prev and sequence are O(1).
+// A k-opt move costs O(k sqrt(n)): segments are split at the removed edges,
+//  reordered and reversed as whole segments, and small neighbors are merged back.
+
 #include "LengthMap.h"
 #include "constants.h"
 #include "point_quadtree/Box.h"
+#include "point_quadtree/Circle.h"
 #include "point_quadtree/Domain.h"
 #include "primitives.h"
 
 #include <array>
+#include <cstdint>
 #include <cstdlib> // abort
 #include <iostream>
+#include <utility> // pair
 #include <vector>
 
 class Tour {
-    using Adjacents = std::array<primitives::point_id_t, 2>;
+    using Links = std::array<primitives::point_id_t, 2>; // internal previous, internal next.
+    using rank_t = int64_t;
 public:
     Tour(const std::vector<primitives::point_id_t>& initial_tour, LengthMap*);
 
-    void forward_swap(const std::vector<primitives::point_id_t> swap, bool cyclic_first);
+    // If reversed, swap was found traversing the tour backwards (prev as next).
+    void forward_swap(const std::vector<primitives::point_id_t>& swap, bool cyclic_first, bool reversed = false);
     void move(primitives::point_id_t a, primitives::point_id_t b);
     void vmove(primitives::point_id_t v, primitives::point_id_t n);
-    primitives::point_id_t next(primitives::point_id_t i) const { return m_next[i]; }
-    primitives::point_id_t prev(primitives::point_id_t i) const;
+    // Moves the path first..last (in tour order) between a and next(a), reversed if reverse.
+    // a must not be in the path or be prev(first).
+    void segment_move(primitives::point_id_t first, primitives::point_id_t last
+        , primitives::point_id_t a, bool reverse);
+    // Removes edges (a, next(a)), (b, next(b)), (c, next(c)), (d, next(d)), given in tour order,
+    //  and reconnects the paths between them in reverse order without reversing any path,
+    //  so that all 4 edges change (double bridge): a to next(c), d to next(b), c to next(a), b to next(d).
+    void double_bridge(primitives::point_id_t a, primitives::point_id_t b
+        , primitives::point_id_t c, primitives::point_id_t d);
+    // While journaling, moves are recorded so that rollback() can undo them.
+    // Enabling journaling again clears the recorded moves.
+    void journal(bool enable);
+    // Undoes the recorded moves, most recent first, and clears them.
+    void rollback();
+    primitives::point_id_t next(primitives::point_id_t i) const
+    {
+        const auto& segment {m_segments[m_parent[i]]};
+        if (i == tail(segment))
+        {
+            const auto order {segment.order + 1u == m_order.size() ? 0u : segment.order + 1u};
+            return head(m_segments[m_order[order]]);
+        }
+        return m_links[i][segment.reversed ? 0 : 1];
+    }
+    primitives::point_id_t prev(primitives::point_id_t i) const
+    {
+        const auto& segment {m_segments[m_parent[i]]};
+        if (i == head(segment))
+        {
+            const auto order {segment.order == 0 ? m_order.size() - 1 : segment.order - 1};
+            return tail(m_segments[m_order[order]]);
+        }
+        return m_links[i][segment.reversed ? 1 : 0];
+    }
     std::vector<primitives::point_id_t> order() const;
-    primitives::point_id_t size() const { return m_next.size(); }
+    primitives::point_id_t size() const { return m_parent.size(); }
+    // Endpoints of edges removed or added by the last move.
+    const std::vector<primitives::point_id_t>& changed() const { return m_changed; }
 
-    primitives::point_id_t sequence(primitives::point_id_t i, primitives::point_id_t start) const;
+    primitives::point_id_t sequence(primitives::point_id_t i, primitives::point_id_t start) const
+    {
+        auto start_sequence {position(start)};
+        auto raw_sequence {position(i)};
+        if (raw_sequence < start_sequence)
+        {
+            raw_sequence += size();
+        }
+        return raw_sequence - start_sequence;
+    }
 
     primitives::space_t x(primitives::point_id_t i) const { return m_length_map->x(i); }
     primitives::space_t y(primitives::point_id_t i) const { return m_length_map->y(i); }
 
-    primitives::length_t length() const;
+    // Maintained incrementally by forward_swap, move, vmove and segment_move.
+    primitives::length_t length() const { return m_length; }
+    // Sums every edge length.
+    primitives::length_t compute_length() const;
     primitives::length_t length(primitives::point_id_t i) const;
     primitives::length_t prev_length(primitives::point_id_t i) const;
     primitives::length_t length(primitives::point_id_t i, primitives::point_id_t j)
@@ -38,27 +97,67 @@ public:
     }
 
     const LengthMap& length_map() const { return *m_length_map; }
+    LengthMap& length_map() { return *m_length_map; }
 
     Box search_box_next(primitives::point_id_t i) const;
     Box search_box_prev(primitives::point_id_t i) const;
     Box search_box(primitives::point_id_t i, primitives::length_t radius) const;
+    Circle search_circle(primitives::point_id_t i, primitives::length_t radius) const;
 
     void validate() const;
 
 private:
+    struct Segment
+    {
+        primitives::point_id_t first {constants::invalid_point}; // in internal orientation.
+        primitives::point_id_t last {constants::invalid_point}; // in internal orientation.
+        primitives::point_id_t size {0};
+        primitives::point_id_t offset {0}; // tour position of the first point in tour orientation.
+        primitives::point_id_t order {0}; // index into m_order.
+        bool reversed {false}; // if tour orientation is opposite to internal orientation.
+    };
+
     LengthMap* m_length_map {nullptr};
-    std::vector<Adjacents> m_adjacents;
-    std::vector<primitives::point_id_t> m_next;
-    std::vector<primitives::point_id_t> m_sequence;
-
-    void reset_adjacencies(const std::vector<primitives::point_id_t>& initial_tour);
-    void update_next();
-
-    primitives::point_id_t get_other(primitives::point_id_t point, primitives::point_id_t adjacent) const;
-    void create_adjacency(primitives::point_id_t point1, primitives::point_id_t point2);
-    void fill_adjacent(primitives::point_id_t point, primitives::point_id_t new_adjacent);
-    void break_adjacency(primitives::point_id_t i);
-    void break_adjacency(primitives::point_id_t point1, primitives::point_id_t point2);
-    void vacate_adjacent_slot(primitives::point_id_t point, primitives::point_id_t adjacent, int slot);
-};
+    primitives::point_id_t m_segment_size {1}; // maximum size of merged segments.
+    primitives::length_t m_length {0};
+    std::vector<primitives::point_id_t> m_parent; // segment of each point.
+    std::vector<rank_t> m_rank; // consecutive within a segment, in internal orientation.
+    std::vector<Links> m_links;
+    std::vector<Segment> m_segments;
+    std::vector<primitives::point_id_t> m_free_segments;
+    std::vector<primitives::point_id_t> m_order; // segments in tour order.
+    std::vector<primitives::point_id_t> m_changed;
+
+    // Reconnection scratch space, reused across moves.
+    std::vector<primitives::point_id_t> m_removed; // removed edge (p, next(p)) is stored as p.
+    std::vector<std::pair<primitives::point_id_t, primitives::point_id_t>> m_added;
+    std::vector<primitives::point_id_t> m_piece_heads;
+    std::vector<primitives::point_id_t> m_slot_partners;
+    std::vector<std::pair<primitives::point_id_t, bool>> m_pieces; // piece, reversed.
+    std::vector<primitives::point_id_t> m_new_order;
+
+    // Journal of recorded moves: removed edges (p, next(p)) followed by added edges.
+    bool m_journaling {false};
+    std::vector<std::pair<primitives::point_id_t, primitives::point_id_t>> m_journal_edges;
+    std::vector<std::pair<size_t, size_t>> m_journal_moves; // removed, added edge counts.
 
+    static primitives::point_id_t head(const Segment& s) { return s.reversed ? s.last : s.first; }
+    static primitives::point_id_t tail(const Segment& s) { return s.reversed ? s.first : s.last; }
+    primitives::point_id_t position(primitives::point_id_t i) const
+    {
+        const auto& segment {m_segments[m_parent[i]]};
+        const auto internal_offset {segment.reversed
+            ? m_rank[segment.last] - m_rank[i]
+            : m_rank[i] - m_rank[segment.first]};
+        return segment.offset + static_cast<primitives::point_id_t>(internal_offset);
+    }
+
+    // Replaces edges m_removed with edges m_added.
+    void reconnect();
+    primitives::point_id_t find_slot(primitives::point_id_t point) const;
+    void split_before(primitives::point_id_t i);
+    primitives::point_id_t allocate_segment();
+    void absorb(primitives::point_id_t destination, primitives::point_id_t source, bool at_tail);
+    void merge_small_segments();
+    void renumber_segments();
+};
@@ -0,0 +1,389 @@
+// Microbenchmarks of the hot paths on generated instances.
+// Each result is one JSON object per line on stdout, so runs can be diffed across commits:
+//  {"benchmark": ..., "instance": ..., "n": ..., "ops": ..., "ns_per_op": ...,
+//   "ops_per_second": ..., "items_per_op": ..., "allocations_per_op": ...}
+// items_per_op is benchmark-specific (e.g. points returned per query).
+// Allocations are counted by replacing the global operator new.
+
+#include "CandidateSet.h"
+#include "LengthMap.h"
+#include "Tour.h"
+#include "constants.h"
+#include "construction.h"
+#include "forward/Finder.h"
+#include "options.h"
+#include "point_quadtree/Domain.h"
+#include "point_quadtree/Tree.h"
+#include "point_quadtree/morton_keys.h"
+
+#include <algorithm> // sort
+#include <atomic>
+#include <chrono>
+#include <cmath> // ceil, round, sqrt
+#include <cstdlib> // free, malloc
+#include <iostream>
+#include <new> // bad_alloc
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> allocations {0};
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto memory {std::malloc(size == 0 ? 1 : size)})
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace {
+
+using Coordinates = std::array<std::vector<primitives::space_t>, 2>;
+using Clock = std::chrono::steady_clock;
+
+constexpr primitives::space_t domain_size {1000000};
+
+Coordinates uniform(size_t n, std::mt19937_64& random)
+{
+    std::uniform_int_distribution<int> coordinate(0, domain_size);
+    Coordinates points;
+    for (size_t i {0}; i < n; ++i)
+    {
+        points[0].push_back(coordinate(random));
+        points[1].push_back(coordinate(random));
+    }
+    return points;
+}
+
+// sqrt(n) normally distributed clusters.
+Coordinates clustered(size_t n, std::mt19937_64& random)
+{
+    const auto cluster_count {static_cast<size_t>(std::sqrt(n)) + 1};
+    const auto centers {uniform(cluster_count, random)};
+    std::uniform_int_distribution<size_t> cluster(0, cluster_count - 1);
+    std::normal_distribution<primitives::space_t> offset(0, domain_size / cluster_count);
+    Coordinates points;
+    for (size_t i {0}; i < n; ++i)
+    {
+        const auto c {cluster(random)};
+        points[0].push_back(std::round(centers[0][c] + offset(random)));
+        points[1].push_back(std::round(centers[1][c] + offset(random)));
+    }
+    return points;
+}
+
+// Square lattice; many equal lengths.
+Coordinates grid(size_t n, std::mt19937_64&)
+{
+    const auto side {static_cast<size_t>(std::ceil(std::sqrt(n)))};
+    const auto spacing {domain_size / side};
+    Coordinates points;
+    for (size_t i {0}; i < n; ++i)
+    {
+        points[0].push_back((i % side) * spacing);
+        points[1].push_back((i / side) * spacing);
+    }
+    return points;
+}
+
+// Clusters of 9 points on a 3x3 unit lattice; the quadtree subdivides each cluster
+//  down to the maximum depth, making about 1.5 times as many nodes as points.
+Coordinates deep(size_t n, std::mt19937_64& random)
+{
+    const auto centers {uniform(n / 9 + 1, random)};
+    Coordinates points;
+    for (size_t i {0}; i < n; ++i)
+    {
+        const auto c {i / 9};
+        points[0].push_back(centers[0][c] + i % 3);
+        points[1].push_back(centers[1][c] + (i / 3) % 3);
+    }
+    return points;
+}
+
+struct Result
+{
+    size_t ops {0};
+    size_t items {0};
+    size_t allocations {0};
+    double seconds {0};
+};
+
+// Calls operation(op) in batches until at least min_seconds have passed; operation returns its item count.
+template <typename Operation>
+Result measure(double min_seconds, const Operation& operation, size_t batch = 64)
+{
+    Result result;
+    const auto start_allocations {allocations.load()};
+    const auto start {Clock::now()};
+    do
+    {
+        for (size_t k {0}; k < batch; ++k)
+        {
+            result.items += operation(result.ops++);
+        }
+        result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (result.seconds < min_seconds);
+    result.allocations = allocations.load() - start_allocations;
+    return result;
+}
+
+void report(const std::string& benchmark, const std::string& instance, size_t n, const Result& result)
+{
+    const auto ops {static_cast<double>(result.ops)};
+    std::cout << "{\"benchmark\": \"" << benchmark << "\""
+        << ", \"instance\": \"" << instance << "\""
+        << ", \"n\": " << n
+        << ", \"ops\": " << result.ops
+        << ", \"ns_per_op\": " << result.seconds * 1e9 / ops
+        << ", \"ops_per_second\": " << ops / result.seconds
+        << ", \"items_per_op\": " << result.items / ops
+        << ", \"allocations_per_op\": " << result.allocations / ops
+        << "}" << std::endl;
+}
+
+void run(const std::string& instance, const Coordinates& points, double min_seconds, size_t finder_max_size)
+{
+    const auto& x {points[0]};
+    const auto& y {points[1]};
+    const auto n {x.size()};
+    const point_quadtree::Domain domain(x, y);
+    const auto morton_keys {point_quadtree::morton_keys::compute_point_morton_keys(x, y, domain)};
+    const point_quadtree::Tree tree(x, y, morton_keys, domain);
+    const auto initial_tour {construction::greedy(x, y, tree, domain)};
+    std::mt19937_64 random(1);
+    std::uniform_int_distribution<primitives::point_id_t> point(0, n - 1);
+
+    // Quadtree circle queries with about 16 points per circle.
+    {
+        const Circle area {0, 0, domain_size};
+        const auto radius {std::sqrt(16 * area.radius * area.radius / (constants::pi * n))};
+        std::vector<primitives::point_id_t> found;
+        // Check a sample of queries against brute force first.
+        std::vector<primitives::point_id_t> expected;
+        for (size_t k {0}; k < std::min<size_t>(n, 1000); ++k)
+        {
+            const auto i {static_cast<primitives::point_id_t>(k * n / std::min<size_t>(n, 1000))};
+            const Circle circle {x[i], y[i], radius};
+            found.clear();
+            tree.get_points(i, circle, found);
+            expected.clear();
+            for (primitives::point_id_t j {0}; j < n; ++j)
+            {
+                if (circle.contains(x[j], y[j]))
+                {
+                    expected.push_back(j);
+                }
+            }
+            std::sort(std::begin(found), std::end(found));
+            if (found != expected)
+            {
+                std::cout << "tree circle query mismatch at point " << i << std::endl;
+                break;
+            }
+        }
+        report("tree_circle_query", instance, n, measure(min_seconds, [&](size_t op)
+        {
+            const auto i {static_cast<primitives::point_id_t>(op % n)};
+            found.clear();
+            tree.get_points(i, Circle {x[i], y[i], radius}, found);
+            return found.size();
+        }));
+    }
+
+    // Lengths of tour-adjacent and candidate pairs, which the search queries repeatedly.
+    CandidateSet candidates(x, y, tree, domain, 8, 0);
+    {
+        LengthMap length_map(x, y);
+        candidates.compute_lengths(length_map);
+    }
+    for (auto cache : {LengthMap::Cache::none, LengthMap::Cache::flat, LengthMap::Cache::neighbor})
+    {
+        const char* names[] {"length_none", "length_flat", "length_neighbor"};
+        LengthMap length_map(x, y, cache);
+        primitives::length_t sum {0};
+        report(names[static_cast<int>(cache)], instance, n, measure(min_seconds, [&](size_t op)
+        {
+            const auto i {static_cast<primitives::point_id_t>((op / 8) % n)};
+            const auto neighbors {candidates.neighbors(i)};
+            sum += length_map.length(i, neighbors.begin()[op % neighbors.size()]);
+            return 1;
+        }));
+        if (sum == 0)
+        {
+            std::cout << "unexpected zero length sum" << std::endl;
+        }
+    }
+
+    // Uncached lengths from narrow coordinate storage, on coordinates rounded to integers
+    //  so that int32 storage applies.
+    {
+        std::vector<primitives::space_t> rounded_x;
+        std::vector<primitives::space_t> rounded_y;
+        for (size_t i {0}; i < n; ++i)
+        {
+            rounded_x.push_back(std::round(x[i]));
+            rounded_y.push_back(std::round(y[i]));
+        }
+        for (auto storage : {LengthMap::Storage::double_precision, LengthMap::Storage::int32, LengthMap::Storage::float32})
+        {
+            const char* names[] {"length_rounded_double", "length_rounded_int32", "length_rounded_float32"};
+            LengthMap length_map(rounded_x, rounded_y, LengthMap::Cache::none, 0, storage);
+            primitives::length_t sum {0};
+            report(names[static_cast<int>(storage)], instance, n, measure(min_seconds, [&](size_t op)
+            {
+                const auto i {static_cast<primitives::point_id_t>((op / 8) % n)};
+                const auto neighbors {candidates.neighbors(i)};
+                sum += length_map.length(i, neighbors.begin()[op % neighbors.size()]);
+                return 1;
+            }));
+            if (sum == 0)
+            {
+                std::cout << "unexpected zero length sum" << std::endl;
+            }
+        }
+    }
+
+    // Uncached lengths from each point to all of its candidates, as one batch.
+    {
+        LengthMap length_map(x, y);
+        std::vector<primitives::length_t> lengths;
+        primitives::length_t sum {0};
+        report("length_batch", instance, n, measure(min_seconds, [&](size_t op)
+        {
+            const auto i {static_cast<primitives::point_id_t>(op % n)};
+            const auto neighbors {candidates.neighbors(i)};
+            lengths.resize(neighbors.size());
+            length_map.lengths(i, neighbors.begin(), neighbors.size(), lengths.data());
+            sum += lengths.back();
+            return neighbors.size();
+        }));
+        if (sum == 0)
+        {
+            std::cout << "unexpected zero length sum" << std::endl;
+        }
+    }
+
+    // Random valid forward swaps (option 1) of 2 and 3 points after the first.
+    {
+        LengthMap length_map(x, y);
+        Tour tour(initial_tour, &length_map);
+        std::vector<primitives::point_id_t> swap;
+        for (size_t k : {2, 3})
+        {
+            report("forward_swap_" + std::to_string(k + 1) + "opt", instance, n, measure(min_seconds, [&](size_t)
+            {
+                swap.assign(1, point(random));
+                for (size_t j {0}; j < k; ++j)
+                {
+                    swap.push_back(point(random));
+                }
+                const auto start {swap.front()};
+                std::sort(std::begin(swap) + 1, std::end(swap), [&tour, start](auto a, auto b)
+                {
+                    return tour.sequence(a, start) < tour.sequence(b, start);
+                });
+                primitives::point_id_t previous {1};
+                for (size_t j {1}; j < swap.size(); ++j)
+                {
+                    const auto sequence {tour.sequence(swap[j], start)};
+                    if (sequence < previous + 1 or sequence + 1u >= n)
+                    {
+                        return 0; // not a valid forward swap; counted as a no-op.
+                    }
+                    previous = sequence;
+                }
+                tour.forward_swap(swap, false);
+                return 1;
+            }));
+        }
+    }
+
+    // One best-improvement sweep over all start points.
+    // Search depth is unbounded and grows with n, so large instances are skipped.
+    if (n <= finder_max_size)
+    {
+        LengthMap length_map(x, y);
+        Tour tour(initial_tour, &length_map);
+        forward::Finder finder(tree, tour);
+        finder.use_candidates(&candidates);
+        finder.both_directions(false);
+        report("finder_sweep", instance, n, measure(min_seconds, [&](size_t)
+        {
+            return finder.find_best().size();
+        }, 1));
+    }
+}
+
+std::vector<size_t> parse_sizes(const std::string& text)
+{
+    std::vector<size_t> sizes;
+    std::stringstream stream(text);
+    std::string size;
+    while (std::getline(stream, size, ','))
+    {
+        sizes.push_back(std::stoull(size));
+    }
+    return sizes;
+}
+
+} // namespace
+
+int main(int argc, const char** argv)
+{
+    const options::Options options(argc, argv);
+    options.check_names({"help", "sizes", "instances", "milliseconds", "finder_max_size"});
+    if (options.has("help"))
+    {
+        std::cout << "Options:\n"
+            << "    --sizes=N,N,...: instance sizes (default: 100,10000,100000)\n"
+            << "    --instances=all|uniform|clustered|grid|deep (default: all)\n"
+            << "    --milliseconds=T: minimum time per benchmark (default: 200)\n"
+            << "    --finder_max_size=N: largest instance for the Finder sweep benchmark (default: 100)\n"
+            << std::endl;
+        return 0;
+    }
+    const auto sizes {parse_sizes(options.get("sizes", "100,10000,100000"))};
+    const auto instances {options.get_choice("instances", {"all", "uniform", "clustered", "grid", "deep"}, 0)};
+    const auto min_seconds {options.get_size("milliseconds", 200) / 1000.0};
+    const auto finder_max_size {options.get_size("finder_max_size", 100)};
+    for (auto n : sizes)
+    {
+        std::mt19937_64 random(n);
+        if (instances == 0 or instances == 1)
+        {
+            run("uniform", uniform(n, random), min_seconds, finder_max_size);
+        }
+        if (instances == 0 or instances == 2)
+        {
+            run("clustered", clustered(n, random), min_seconds, finder_max_size);
+        }
+        if (instances == 0 or instances == 3)
+        {
+            run("grid", grid(n, random), min_seconds, finder_max_size);
+        }
+        if (instances == 0 or instances == 4)
+        {
+            run("deep", deep(n, random), min_seconds, finder_max_size);
+        }
+    }
+    return 0;
+}
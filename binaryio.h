@@ -0,0 +1,222 @@
+#pragma once
+
+// Versioned binary files for point sets and tours, loaded through fileio::MappedFile.
+// Layout: a Header, then arrays in native byte order:
+//  points: x[count], y[count] (primitives::space_t), then morton_keys[count]
+//   (primitives::morton_key_t) if flags has has_morton_keys.
+//  tour: point ids[count] (primitives::point_id_t), zero-based, in tour order.
+// Morton keys are those of point_quadtree::morton_keys::compute_point_morton_keys
+//  with the Domain of the same points, so they can be reused instead of recomputed.
+// Readers reject other versions, byte orders and sizes of the elements stored in the file
+//  (so point sets can be read by builds with other point id widths, but tours cannot).
+
+#include "constants.h"
+#include "fileio.h"
+#include "primitives.h"
+
+#include <cstdint>
+#include <cstdio> // fopen, fwrite
+#include <cstdlib> // abort, exit
+#include <cstring> // memcpy, memcmp
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace binaryio {
+
+constexpr char magic[8] {'F', 'K', 'O', 'P', 'T', 'B', 'I', 'N'};
+constexpr uint32_t version {1};
+constexpr uint32_t byte_order_mark {0x01020304};
+enum class Kind : uint32_t { points = 1, tour = 2 };
+constexpr uint64_t has_morton_keys {1};
+
+struct Header
+{
+    char magic[8] {};
+    uint32_t version {0};
+    uint32_t byte_order {0};
+    uint32_t kind {0};
+    uint32_t element_sizes {0}; // sizeof space_t, morton_key_t, point_id_t, one byte each.
+    uint64_t count {0};
+    uint64_t flags {0};
+};
+static_assert(sizeof(Header) == 40, "binary header layout changed.");
+
+constexpr uint32_t element_sizes {sizeof(primitives::space_t)
+    | sizeof(primitives::morton_key_t) << 8
+    | sizeof(primitives::point_id_t) << 16};
+
+// Bytes of element_sizes that apply to each kind of file.
+constexpr uint32_t element_sizes_mask(Kind kind)
+{
+    return kind == Kind::points ? 0x0000FFFF : 0x00FF0000;
+}
+
+struct PointSet
+{
+    std::vector<primitives::space_t> x;
+    std::vector<primitives::space_t> y;
+    std::vector<primitives::morton_key_t> morton_keys; // empty if not stored.
+};
+
+// If file_path starts with the binary magic.
+inline bool is_binary(const char* file_path)
+{
+    std::ifstream file(file_path, std::ios::binary);
+    char start[sizeof(magic)] {};
+    return file.read(start, sizeof(start)) and std::memcmp(start, magic, sizeof(magic)) == 0;
+}
+
+inline Header make_header(Kind kind, uint64_t count, uint64_t flags)
+{
+    Header header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order = byte_order_mark;
+    header.kind = static_cast<uint32_t>(kind);
+    header.element_sizes = element_sizes;
+    header.count = count;
+    header.flags = flags;
+    return header;
+}
+
+template <typename T>
+void write_array(std::FILE* file, const std::vector<T>& values)
+{
+    std::fwrite(values.data(), sizeof(T), values.size(), file);
+}
+
+template <typename T>
+void read_array(const char*& cursor, size_t count, std::vector<T>& values)
+{
+    values.resize(count);
+    std::memcpy(values.data(), cursor, count * sizeof(T));
+    cursor += count * sizeof(T);
+}
+
+inline void open_for_write(const char* file_path, const Header& header, std::FILE*& file)
+{
+    file = std::fopen(file_path, "wb");
+    if (not file or std::fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        std::cout << __func__ << ": error: could not write file: " << file_path << std::endl;
+        std::abort();
+    }
+}
+
+inline void finish_write(const char* file_path, std::FILE* file)
+{
+    if (std::ferror(file) or std::fclose(file) != 0)
+    {
+        std::cout << __func__ << ": error: could not write file: " << file_path << std::endl;
+        std::abort();
+    }
+}
+
+// morton_keys can be empty.
+inline void write_points(const char* file_path
+    , const std::vector<primitives::space_t>& x
+    , const std::vector<primitives::space_t>& y
+    , const std::vector<primitives::morton_key_t>& morton_keys)
+{
+    std::FILE* file {nullptr};
+    open_for_write(file_path, make_header(Kind::points, x.size(), morton_keys.empty() ? 0 : has_morton_keys), file);
+    write_array(file, x);
+    write_array(file, y);
+    write_array(file, morton_keys);
+    finish_write(file_path, file);
+}
+
+inline void write_tour(const char* file_path, const std::vector<primitives::point_id_t>& ordered_points)
+{
+    std::FILE* file {nullptr};
+    open_for_write(file_path, make_header(Kind::tour, ordered_points.size(), 0), file);
+    write_array(file, ordered_points);
+    finish_write(file_path, file);
+}
+
+// Checks the header, the point count and the file size; returns the start of the arrays.
+inline const char* read_header(const char* file_path, std::string_view text, Kind kind, Header& header)
+{
+    if (text.size() < sizeof(Header))
+    {
+        std::cout << __func__ << ": error: file too small for a binary header: " << file_path << std::endl;
+        std::abort();
+    }
+    std::memcpy(&header, text.data(), sizeof(Header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 or header.version != version
+        or header.byte_order != byte_order_mark or header.kind != static_cast<uint32_t>(kind)
+        or (header.element_sizes & element_sizes_mask(kind)) != (element_sizes & element_sizes_mask(kind)))
+    {
+        std::cout << __func__ << ": error: unsupported binary file version, byte order, kind or element sizes: "
+            << file_path << std::endl;
+        std::abort();
+    }
+    if (header.count == 0 or header.count > constants::max_point_count)
+    {
+        std::cout << __func__ << ": error: point count " << header.count << " is not between 1 and "
+            << constants::max_point_count << ": " << file_path << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    size_t expected {sizeof(Header)};
+    if (kind == Kind::points)
+    {
+        expected += header.count * 2 * sizeof(primitives::space_t);
+        if (header.flags & has_morton_keys)
+        {
+            expected += header.count * sizeof(primitives::morton_key_t);
+        }
+    }
+    else
+    {
+        expected += header.count * sizeof(primitives::point_id_t);
+    }
+    if (text.size() != expected)
+    {
+        std::cout << __func__ << ": error: expected " << expected << " bytes but got "
+            << text.size() << ": " << file_path << std::endl;
+        std::abort();
+    }
+    return text.data() + sizeof(Header);
+}
+
+inline PointSet read_points(const char* file_path)
+{
+    std::cout << "\nReading binary point set file: " << file_path << std::endl;
+    const fileio::MappedFile file(file_path);
+    Header header;
+    auto cursor {read_header(file_path, file.text(), Kind::points, header)};
+    PointSet points;
+    read_array(cursor, header.count, points.x);
+    read_array(cursor, header.count, points.y);
+    if (header.flags & has_morton_keys)
+    {
+        read_array(cursor, header.count, points.morton_keys);
+    }
+    std::cout << "Finished reading " << header.count << " points"
+        << (points.morton_keys.empty() ? "" : " and morton keys") << ".\n" << std::endl;
+    return points;
+}
+
+inline std::vector<primitives::point_id_t> read_tour(const char* file_path)
+{
+    std::cout << "\nReading binary tour file: " << file_path << std::endl;
+    const fileio::MappedFile file(file_path);
+    Header header;
+    auto cursor {read_header(file_path, file.text(), Kind::tour, header)};
+    std::vector<primitives::point_id_t> ordered_points;
+    read_array(cursor, header.count, ordered_points);
+    for (auto p : ordered_points)
+    {
+        if (p >= header.count)
+        {
+            std::cout << __func__ << ": error: invalid point id: " << p << std::endl;
+            std::abort();
+        }
+    }
+    std::cout << "Finished reading tour file.\n" << std::endl;
+    return ordered_points;
+}
+
+} // namespace binaryio
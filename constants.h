@@ -2,18 +2,53 @@
 
 #include "primitives.h"
 
+#include <array>
+#include <cstddef> // size_t
+
 namespace constants {
 
 constexpr auto invalid_point {std::numeric_limits<primitives::point_id_t>::max()};
+// Largest point count, so that the sum of two point ids or sequence numbers fits point_id_t.
+constexpr size_t max_point_count {invalid_point / 2};
+
+constexpr primitives::space_t pi {3.141592653589793};
 
-constexpr int save_period {1};
+constexpr size_t save_period {1}; // minimum improvements between checkpoints.
+constexpr size_t save_seconds {1}; // minimum seconds between checkpoints.
 
 constexpr primitives::depth_t max_tree_depth{21}; // maximum quadtree depth / level.
+constexpr primitives::point_id_t quadtree_leaf_size {8}; // nodes with more points are subdivided.
+
+constexpr primitives::point_id_t min_tour_segment_size {8}; // Tour segments hold up to max(this, sqrt(n) + 1) points.
+
+constexpr size_t flat_length_cache_size {1 << 20}; // default LengthMap::Cache::flat entries.
+constexpr size_t flat_length_cache_probes {4}; // open-addressing probe window.
+constexpr size_t neighbor_length_slots {8}; // default LengthMap::Cache::neighbor slots per point.
+
+// forward::Finder search bounds with a CandidateSet; quadtree searches stay exhaustive.
+constexpr size_t candidate_max_swap_size {10}; // most edges removed by one swap.
+// additions searched from a partial swap of 2, 3, 4 removed edges (nearest first); 1 from longer ones.
+constexpr std::array<size_t, 3> candidate_breadth {5, 3, 2};
+
+constexpr primitives::space_t quadrant_search_factor {4}; // CandidateSet quadrant search radius, in K-th nearest distances.
+
+constexpr size_t greedy_candidates {10}; // nearest neighbors considered as greedy construction edges.
+
+constexpr primitives::point_id_t or_opt_max_segment {3}; // longest path moved by or_opt::Optimizer.
+
+constexpr size_t kick_neighbors {8}; // nearby points that perturbation::DoubleBridge chooses edges from.
+
+constexpr size_t multistart_kick_points {100}; // points per double bridge perturbing a repeated start.
+
+constexpr size_t partition_tile_points {1000}; // target average points per partition::Solver tile.
+constexpr size_t partition_rounds {8}; // maximum partition::Solver rounds.
 
 constexpr bool verbose {false};
 constexpr bool write_best {true};
 constexpr bool print_local_optima {true};
 constexpr bool print_iterations {true};
 constexpr bool verify {true};
+constexpr bool verify_tour_length {false}; // recompute the tour length after every move (O(n)).
+constexpr bool search_stats {false}; // count search work and write per-iteration statistics (see forward/Stats.h).
 
 } // namespace constants
@@ -0,0 +1,212 @@
+#include "construction.h"
+
+#include "CandidateSet.h"
+#include "constants.h"
+
+#include <algorithm> // min, sort, swap
+#include <array>
+#include <cstdint>
+#include <numeric> // iota
+#include <tuple> // tie
+
+namespace construction {
+
+namespace {
+
+using Adjacency = std::array<primitives::point_id_t, 2>;
+
+// Index of integer coordinates (x, y) on a Hilbert curve filling a 2^order grid.
+uint64_t hilbert_index(uint32_t x, uint32_t y, int order)
+{
+    const uint32_t grid {static_cast<uint32_t>(1) << order};
+    uint64_t index {0};
+    for (auto s {grid / 2}; s > 0; s /= 2)
+    {
+        const uint32_t rx {(x & s) > 0};
+        const uint32_t ry {(y & s) > 0};
+        index += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+        // rotate the quadrant so the sub-curve has the canonical orientation.
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = grid - 1 - x;
+                y = grid - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+void link(std::vector<Adjacency>& adjacency, primitives::point_id_t a, primitives::point_id_t b)
+{
+    auto& a_links {adjacency[a]};
+    a_links[a_links[0] == constants::invalid_point ? 0 : 1] = b;
+    auto& b_links {adjacency[b]};
+    b_links[b_links[0] == constants::invalid_point ? 0 : 1] = a;
+}
+
+primitives::point_id_t degree(const Adjacency& links)
+{
+    return (links[0] != constants::invalid_point) + (links[1] != constants::invalid_point);
+}
+
+primitives::point_id_t find_root(std::vector<primitives::point_id_t>& parent, primitives::point_id_t i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]]; // path halving.
+        i = parent[i];
+    }
+    return i;
+}
+
+} // namespace
+
+std::vector<primitives::point_id_t> morton(const point_quadtree::Tree& tree)
+{
+    return tree.points();
+}
+
+std::vector<primitives::point_id_t> hilbert(const std::vector<primitives::space_t>& x
+    , const std::vector<primitives::space_t>& y
+    , const point_quadtree::Domain& domain)
+{
+    // same grid resolution as the Morton keys.
+    constexpr int order {constants::max_tree_depth - 1};
+    constexpr uint32_t max_coordinate {(static_cast<uint32_t>(1) << order) - 1};
+    const auto to_grid = [max_coordinate](primitives::space_t normalized)
+    {
+        return std::min(static_cast<uint32_t>(normalized * (max_coordinate + 1)), max_coordinate);
+    };
+    std::vector<uint64_t> keys(x.size());
+    for (primitives::point_id_t i {0}; i < x.size(); ++i)
+    {
+        keys[i] = hilbert_index(to_grid((x[i] - domain.xmin()) / domain.xdim(0))
+            , to_grid((y[i] - domain.ymin()) / domain.ydim(0)), order);
+    }
+    std::vector<primitives::point_id_t> tour(x.size());
+    std::iota(std::begin(tour), std::end(tour), 0);
+    std::sort(std::begin(tour), std::end(tour)
+        , [&keys](auto a, auto b) { return std::tie(keys[a], a) < std::tie(keys[b], b); });
+    return tour;
+}
+
+std::vector<primitives::point_id_t> nearest_neighbor(const point_quadtree::Tree& tree)
+{
+    const auto point_count {static_cast<primitives::point_id_t>(tree.points().size())};
+    std::vector<primitives::point_id_t> tour;
+    tour.reserve(point_count);
+    auto unvisited {tree.full_subset()};
+    primitives::point_id_t current {0};
+    while (current != constants::invalid_point)
+    {
+        tour.push_back(current);
+        tree.remove(unvisited, current);
+        current = tree.nearest(unvisited, current);
+    }
+    return tour;
+}
+
+std::vector<primitives::point_id_t> greedy(const std::vector<primitives::space_t>& x
+    , const std::vector<primitives::space_t>& y
+    , const point_quadtree::Tree& tree
+    , const point_quadtree::Domain& domain)
+{
+    const auto point_count {static_cast<primitives::point_id_t>(x.size())};
+    if (point_count < 3)
+    {
+        return morton(tree);
+    }
+
+    // Candidate edges, shortest first.
+    const CandidateSet candidates(x, y, tree, domain, constants::greedy_candidates, 0);
+    struct Edge
+    {
+        primitives::space_t length_squared {0};
+        primitives::point_id_t a {0};
+        primitives::point_id_t b {0};
+    };
+    std::vector<Edge> edges;
+    edges.reserve(candidates.size());
+    for (primitives::point_id_t a {0}; a < point_count; ++a)
+    {
+        for (auto b : candidates.neighbors(a))
+        {
+            const auto dx {x[a] - x[b]};
+            const auto dy {y[a] - y[b]};
+            edges.push_back({dx * dx + dy * dy, std::min(a, b), std::max(a, b)});
+        }
+    }
+    std::sort(std::begin(edges), std::end(edges), [](const auto& e, const auto& f)
+    {
+        return std::tie(e.length_squared, e.a, e.b) < std::tie(f.length_squared, f.a, f.b);
+    });
+
+    // Fragments: degree <= 2 and no cycles (union-find).
+    std::vector<Adjacency> adjacency(point_count, {constants::invalid_point, constants::invalid_point});
+    std::vector<primitives::point_id_t> fragment(point_count);
+    std::iota(std::begin(fragment), std::end(fragment), 0);
+    primitives::point_id_t added {0};
+    for (const auto& edge : edges)
+    {
+        if (added + 1 == point_count)
+        {
+            break;
+        }
+        if (degree(adjacency[edge.a]) == 2 or degree(adjacency[edge.b]) == 2)
+        {
+            continue;
+        }
+        const auto root_a {find_root(fragment, edge.a)};
+        const auto root_b {find_root(fragment, edge.b)};
+        if (root_a == root_b)
+        {
+            continue; // also skips duplicates of added edges.
+        }
+        fragment[root_a] = root_b;
+        link(adjacency, edge.a, edge.b);
+        ++added;
+    }
+
+    // Walk the fragments, joining each fragment's end to the nearest free endpoint.
+    auto endpoints {tree.full_subset()};
+    primitives::point_id_t start {constants::invalid_point};
+    for (primitives::point_id_t i {0}; i < point_count; ++i)
+    {
+        if (degree(adjacency[i]) == 2)
+        {
+            tree.remove(endpoints, i);
+        }
+        else if (start == constants::invalid_point)
+        {
+            start = i;
+        }
+    }
+    std::vector<primitives::point_id_t> tour;
+    tour.reserve(point_count);
+    auto current {start};
+    while (current != constants::invalid_point)
+    {
+        tree.remove(endpoints, current);
+        auto previous {constants::invalid_point};
+        while (true)
+        {
+            tour.push_back(current);
+            const auto& links {adjacency[current]};
+            const auto next {links[0] != previous ? links[0] : links[1]};
+            if (next == constants::invalid_point or next == previous)
+            {
+                break;
+            }
+            previous = current;
+            current = next;
+        }
+        tree.remove(endpoints, current);
+        current = tree.nearest(endpoints, current);
+    }
+    return tour;
+}
+
+} // namespace construction
@@ -0,0 +1,32 @@
+#pragma once
+
+// Initial tour constructors. Better starting tours keep Finder's search radii
+//  (which depend on current tour edge lengths) small from the first iteration.
+//  morton: points in Morton key order, as stored by the quadtree.
+//  hilbert: points sorted by Hilbert curve index, which has no long jumps between quadrants.
+//  nearest_neighbor: repeatedly visits the nearest unvisited point (quadtree search).
+//  greedy: adds the shortest candidate edges that keep every point at degree <= 2
+//   without closing a cycle, then joins the fragments by nearest endpoints.
+
+#include "point_quadtree/Domain.h"
+#include "point_quadtree/Tree.h"
+#include "primitives.h"
+
+#include <vector>
+
+namespace construction {
+
+std::vector<primitives::point_id_t> morton(const point_quadtree::Tree&);
+
+std::vector<primitives::point_id_t> hilbert(const std::vector<primitives::space_t>& x
+    , const std::vector<primitives::space_t>& y
+    , const point_quadtree::Domain&);
+
+std::vector<primitives::point_id_t> nearest_neighbor(const point_quadtree::Tree&);
+
+std::vector<primitives::point_id_t> greedy(const std::vector<primitives::space_t>& x
+    , const std::vector<primitives::space_t>& y
+    , const point_quadtree::Tree&
+    , const point_quadtree::Domain&);
+
+} // namespace construction
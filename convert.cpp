@@ -0,0 +1,49 @@
+#include "binaryio.h"
+#include "fileio.h"
+#include "point_quadtree/Domain.h"
+#include "point_quadtree/morton_keys.h"
+
+#include <iostream>
+#include <string>
+
+int main(int argc, const char** argv)
+{
+    if (argc != 4)
+    {
+        std::cout << "Arguments: points|tour input_file_path output_file_path\n"
+            << "    points: TSPLIB NODE_COORD_SECTION to binary point set with morton keys.\n"
+            << "    tour: TSPLIB TOUR_SECTION to binary tour, or binary tour to TSPLIB TOUR_SECTION.\n"
+            << std::endl;
+        return 0;
+    }
+    const std::string kind {argv[1]};
+    const auto input {argv[2]};
+    const auto output {argv[3]};
+    if (kind == "points")
+    {
+        const auto coordinates {fileio::read_coordinates(input)};
+        const auto& x {coordinates[0]};
+        const auto& y {coordinates[1]};
+        const point_quadtree::Domain domain(x, y);
+        const auto morton_keys {point_quadtree::morton_keys::compute_point_morton_keys(x, y, domain)};
+        binaryio::write_points(output, x, y, morton_keys);
+    }
+    else if (kind == "tour")
+    {
+        if (binaryio::is_binary(input))
+        {
+            fileio::write_ordered_points(binaryio::read_tour(input), output);
+        }
+        else
+        {
+            binaryio::write_tour(output, fileio::read_ordered_points(input));
+        }
+    }
+    else
+    {
+        std::cout << "Unknown conversion: " << kind << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << output << std::endl;
+    return 0;
+}
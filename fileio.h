@@ -1,15 +1,180 @@
 #pragma once
 
+#include "ThreadPool.h"
+#include "constants.h"
 #include "primitives.h"
 
+#include <algorithm> // find_if
 #include <array>
+#include <cctype> // toupper
+#include <cstdint>
+#include <charconv> // from_chars
+#include <cstdlib> // abort, exit
 #include <fstream>
-#include <sstream>
+#include <iostream>
 #include <string>
+#include <string_view>
+#include <system_error> // errc
 #include <vector>
 
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close
+
 namespace fileio {
 
+// Read-only memory mapping of a whole file.
+class MappedFile
+{
+public:
+    explicit MappedFile(const char* file_path)
+    {
+        const int descriptor {::open(file_path, O_RDONLY)};
+        if (descriptor < 0)
+        {
+            std::cout << __func__ << ": error: could not open file: " << file_path << std::endl;
+            std::abort();
+        }
+        struct stat status;
+        if (::fstat(descriptor, &status) == 0 and status.st_size > 0)
+        {
+            m_size = static_cast<size_t>(status.st_size);
+            m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (m_data == MAP_FAILED)
+            {
+                std::cout << __func__ << ": error: could not map file: " << file_path << std::endl;
+                std::abort();
+            }
+            ::madvise(m_data, m_size, MADV_SEQUENTIAL);
+        }
+        ::close(descriptor);
+    }
+    ~MappedFile()
+    {
+        if (m_data)
+        {
+            ::munmap(m_data, m_size);
+        }
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view text() const { return {static_cast<const char*>(m_data), m_data ? m_size : 0}; }
+
+private:
+    void* m_data {nullptr};
+    size_t m_size {0};
+};
+
+// TSPLIB header values and the text of the requested data section.
+struct Header
+{
+    size_t dimension {0};
+    std::string edge_weight_type;
+    // from the line after the section keyword to the EOF keyword or the end of the file.
+    std::string_view section;
+};
+
+inline bool is_space(char c)
+{
+    return c == ' ' or c == '\t' or c == '\r' or c == '\n';
+}
+
+inline std::string_view trim(std::string_view text)
+{
+    while (not text.empty() and is_space(text.front()))
+    {
+        text.remove_prefix(1);
+    }
+    while (not text.empty() and is_space(text.back()))
+    {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+inline bool keyword_equals(std::string_view keyword, std::string_view expected)
+{
+    return keyword.size() == expected.size()
+        and std::equal(std::cbegin(keyword), std::cend(keyword), std::cbegin(expected)
+            , [](char a, char b) { return std::toupper(static_cast<unsigned char>(a)) == b; });
+}
+
+// Header lines are "KEYWORD : value" (the colon is optional), in any order, until section_keyword.
+inline Header read_header(std::string_view text, std::string_view section_keyword)
+{
+    Header header;
+    while (not text.empty())
+    {
+        const auto line_end {std::min(text.find('\n'), text.size())};
+        const auto line {trim(text.substr(0, line_end))};
+        text.remove_prefix(std::min(line_end + 1, text.size()));
+        const auto key_end {std::min({line.find(':'), line.find(' '), line.find('\t'), line.size()})};
+        const auto keyword {line.substr(0, key_end)};
+        auto value {trim(line.substr(key_end))};
+        if (not value.empty() and value.front() == ':')
+        {
+            value = trim(value.substr(1));
+        }
+        if (keyword_equals(keyword, section_keyword))
+        {
+            header.section = text;
+            break;
+        }
+        if (keyword_equals(keyword, "EOF"))
+        {
+            break;
+        }
+        if (keyword_equals(keyword, "DIMENSION"))
+        {
+            const auto result {std::from_chars(value.data(), value.data() + value.size(), header.dimension)};
+            if (result.ec != std::errc())
+            {
+                std::cout << __func__ << ": error: invalid DIMENSION: " << value << std::endl;
+                std::abort();
+            }
+            std::cout << "Number of points according to header: " << header.dimension << std::endl;
+        }
+        else if (keyword_equals(keyword, "EDGE_WEIGHT_TYPE"))
+        {
+            header.edge_weight_type = value;
+        }
+    }
+    // data ends at the EOF keyword, if any.
+    for (auto eof {header.section.find("EOF")}; eof != std::string_view::npos
+        ; eof = header.section.find("EOF", eof + 1))
+    {
+        if (eof == 0 or header.section[eof - 1] == '\n')
+        {
+            header.section = header.section.substr(0, eof);
+            break;
+        }
+    }
+    return header;
+}
+
+// Parses the next whitespace-separated number at or after cursor; returns false at end or on error.
+template <typename Number>
+bool parse_next(const char*& cursor, const char* end, Number& number)
+{
+    while (cursor < end and is_space(*cursor))
+    {
+        ++cursor;
+    }
+    if (cursor == end)
+    {
+        return false;
+    }
+    const auto result {std::from_chars(cursor, end, number)};
+    if (result.ec != std::errc())
+    {
+        return false;
+    }
+    cursor = result.ptr;
+    return true;
+}
+
 // Removes directories and extension from a file path.
 inline std::string extract_filename(const char* file_path)
 {
@@ -40,50 +205,37 @@ inline void write_ordered_points(const std::vector<primitives::point_id_t>& orde
     }
 }
 
+// Reads point ids from TOUR_SECTION until -1, EOF, or DIMENSION ids.
 inline std::vector<primitives::point_id_t> read_ordered_points(const char* file_path)
 {
     std::cout << "\nReading tour file: " << file_path << std::endl;
-    std::ifstream file_stream(file_path);
-    if (not file_stream.is_open())
-    {
-        std::cout << __func__ << ": error: could not open file: "
-            << file_path << std::endl;
-        std::abort();
-    }
-    size_t point_count{0};
-    // header.
-    std::string line;
-    while (not file_stream.eof())
-    {
-        std::getline(file_stream, line);
-        if (line.find("TOUR_SECTION") != std::string::npos) // header end.
-        {
-            break;
-        }
-        if (line.find("DIMENSION") != std::string::npos) // point count.
-        {
-            std::string point_count_string = line.substr(line.find(':') + 1);
-            point_count = std::stoi(point_count_string);
-            std::cout << "Number of points according to header: " << point_count << std::endl;
-        }
-    }
-    if (point_count == 0)
+    const MappedFile file(file_path);
+    const auto header {read_header(file.text(), "TOUR_SECTION")};
+    if (header.dimension == 0)
     {
         std::cout << __func__ << ": error: no DIMENSION header in the tour file." << std::endl;
         std::abort();
     }
-    // point ids.
     std::vector<primitives::point_id_t> point_ids;
-    while (not file_stream.eof())
+    point_ids.reserve(header.dimension);
+    auto cursor {header.section.data()};
+    const auto end {cursor + header.section.size()};
+    int64_t point_id {0};
+    while (point_ids.size() < header.dimension and parse_next(cursor, end, point_id) and point_id != -1)
     {
-        if (point_ids.size() >= point_count)
+        if (point_id < 1 or static_cast<size_t>(point_id) > header.dimension)
         {
-            break;
+            std::cout << __func__ << ": error: invalid point id: " << point_id << std::endl;
+            std::abort();
         }
-        std::getline(file_stream, line);
-        primitives::point_id_t point_id = std::stoi(line);
         point_ids.push_back(point_id - 1); // subtract one to make point id == index.
     }
+    if (point_ids.size() != header.dimension)
+    {
+        std::cout << __func__ << ": error: read " << point_ids.size()
+            << " point ids, but DIMENSION is " << header.dimension << std::endl;
+        std::abort();
+    }
     std::cout << "Finished reading tour file.\n" << std::endl;
     return point_ids;
 }
@@ -98,12 +250,13 @@ inline std::vector<primitives::point_id_t> default_tour(primitives::point_id_t p
     return tour;
 }
 
-inline std::vector<primitives::point_id_t> initial_tour(int argc, const char** argv, primitives::point_id_t point_count)
+// tour_file_path can be null, in which case the default tour is returned.
+inline std::vector<primitives::point_id_t> initial_tour(const char* tour_file_path, primitives::point_id_t point_count)
 {
     std::vector<primitives::point_id_t> tour;
-    if (argc > 2)
+    if (tour_file_path)
     {
-        tour = read_ordered_points(argv[2]);
+        tour = read_ordered_points(tour_file_path);
     }
     else
     {
@@ -112,70 +265,133 @@ inline std::vector<primitives::point_id_t> initial_tour(int argc, const char** a
     return tour;
 }
 
-inline std::array<std::vector<primitives::space_t>, 2> read_coordinates(const char* file_path)
+// Lines of NODE_COORD_SECTION parsed by one thread.
+struct CoordinateChunk
 {
-    std::cout << "\nReading point set file: " << file_path << std::endl;
-    std::ifstream file_stream(file_path);
-    if (not file_stream.is_open())
-    {
-        std::cout << "Could not open file: " << file_path << std::endl;
-        std::exit(EXIT_SUCCESS);
-    }
-    size_t point_count{0};
-    // header.
-    std::string line;
-    while (not file_stream.eof())
+    const char* begin {nullptr};
+    const char* end {nullptr};
+    primitives::point_id_t first_id {0};
+    primitives::point_id_t last_id {0}; // largest id the chunk may write.
+    primitives::point_id_t count {0};
+    bool valid {true};
+};
+
+// Parses "id x y" lines in [chunk.begin, chunk.end) into x[id - 1], y[id - 1].
+// Ids must be consecutive within the chunk and at most chunk.last_id;
+//  consecutiveness across chunks is checked by the caller.
+inline void parse_coordinates(CoordinateChunk& chunk
+    , std::vector<primitives::space_t>& x
+    , std::vector<primitives::space_t>& y)
+{
+    auto cursor {chunk.begin};
+    primitives::point_id_t point_id {0};
+    while (parse_next(cursor, chunk.end, point_id))
     {
-        std::getline(file_stream, line);
-        if (line.find("NODE_COORD_SECTION") != std::string::npos) // header end.
+        if (chunk.count == 0)
         {
-            break;
+            chunk.first_id = point_id;
         }
-        if (line.find("DIMENSION") != std::string::npos) // point count.
+        if (point_id != chunk.first_id + chunk.count or point_id == 0 or point_id > chunk.last_id
+            or not parse_next(cursor, chunk.end, x[point_id - 1])
+            or not parse_next(cursor, chunk.end, y[point_id - 1]))
         {
-            std::string point_count_string = line.substr(line.find(':') + 1);
-            point_count = std::stoi(point_count_string);
-            std::cout << "Number of points according to header: " << point_count << std::endl;
+            chunk.valid = false;
+            return;
         }
+        ++chunk.count;
     }
-    if (point_count == 0)
+    while (cursor < chunk.end and is_space(*cursor))
+    {
+        ++cursor;
+    }
+    chunk.valid = cursor == chunk.end;
+}
+
+// threads > 1 parses chunks of lines in parallel.
+inline std::array<std::vector<primitives::space_t>, 2> read_coordinates(const char* file_path, size_t threads = 1)
+{
+    std::cout << "\nReading point set file: " << file_path << std::endl;
+    const MappedFile file(file_path);
+    const auto header {read_header(file.text(), "NODE_COORD_SECTION")};
+    if (header.dimension == 0)
     {
         std::cout << "Could not read any points from the point set file." << std::endl;
-        std::exit(EXIT_SUCCESS);
+        std::exit(EXIT_FAILURE);
+    }
+    if (header.dimension > constants::max_point_count)
+    {
+        std::cout << __func__ << ": error: DIMENSION " << header.dimension << " is more than the "
+            << constants::max_point_count << " points supported by " << 8 * sizeof(primitives::point_id_t)
+            << "-bit point ids." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    if (not header.edge_weight_type.empty() and header.edge_weight_type != "EUC_2D")
+    {
+        std::cout << __func__ << ": warning: EDGE_WEIGHT_TYPE " << header.edge_weight_type
+            << " is treated as EUC_2D." << std::endl;
     }
 
-    // read coordinates.
-    std::vector<primitives::space_t> x, y;
-    while (not file_stream.eof())
+    std::array<std::vector<primitives::space_t>, 2> coordinates;
+    auto& x {coordinates[0]};
+    auto& y {coordinates[1]};
+    x.resize(header.dimension);
+    y.resize(header.dimension);
+
+    // chunks start at line beginnings.
+    const auto text {header.section};
+    const auto chunk_count {std::max(static_cast<size_t>(1), std::min(threads, text.size() / (1 << 16)))};
+    std::vector<CoordinateChunk> chunks(chunk_count);
+    size_t chunk_begin {0};
+    for (size_t c {0}; c < chunk_count; ++c)
     {
-        if (x.size() >= point_count)
-        {
-            break;
-        }
-        std::getline(file_stream, line);
-        std::stringstream line_stream(line);
-        primitives::point_id_t point_id{0};
-        line_stream >> point_id;
-        if (point_id == x.size() + 1)
+        auto chunk_end {c + 1 == chunk_count ? text.size() : text.size() * (c + 1) / chunk_count};
+        chunk_end = std::min(text.find('\n', std::max(chunk_end, chunk_begin)), text.size());
+        chunks[c].begin = text.data() + chunk_begin;
+        chunks[c].end = text.data() + chunk_end;
+        chunk_begin = chunk_end;
+    }
+    // Each chunk may only write ids below the first id of the next nonempty chunk,
+    //  so chunks never write the same point, even if the file repeats an id.
+    primitives::point_id_t last_id {static_cast<primitives::point_id_t>(header.dimension)};
+    for (auto chunk {std::rbegin(chunks)}; chunk != std::rend(chunks); ++chunk)
+    {
+        chunk->last_id = last_id;
+        auto cursor {chunk->begin};
+        primitives::point_id_t first_id {0};
+        if (parse_next(cursor, chunk->end, first_id))
         {
-            primitives::space_t value{0};
-            line_stream >> value;
-            x.push_back(value);
-            line_stream >> value;
-            y.push_back(value);
+            last_id = first_id == 0 ? 0 : first_id - 1;
         }
-        else
+    }
+    if (chunk_count == 1)
+    {
+        parse_coordinates(chunks[0], x, y);
+    }
+    else
+    {
+        ThreadPool(chunk_count).run(chunk_count
+            , [&chunks, &x, &y](size_t, size_t c) { parse_coordinates(chunks[c], x, y); });
+    }
+
+    primitives::point_id_t read {0};
+    for (const auto& chunk : chunks)
+    {
+        if (not chunk.valid or (chunk.count > 0 and chunk.first_id != read + 1))
         {
-            std::cout << __func__ << ": error: point id ("
-                << point_id
-                << ") does not match number of currently read points ("
-                << x.size()
-                << ")." << std::endl;
-            std::exit(EXIT_SUCCESS);
+            std::cout << __func__ << ": error: invalid NODE_COORD_SECTION line after point id "
+                << read << "; ids must be consecutive from 1 to DIMENSION." << std::endl;
+            std::exit(EXIT_FAILURE);
         }
+        read += chunk.count;
+    }
+    if (read != header.dimension)
+    {
+        std::cout << __func__ << ": error: read " << read
+            << " points, but DIMENSION is " << header.dimension << std::endl;
+        std::exit(EXIT_FAILURE);
     }
     std::cout << "Finished reading point set file.\n" << std::endl;
-    return {x, y};
+    return coordinates;
 }
 
 } // namespace fileio
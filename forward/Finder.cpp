@@ -1,149 +1,569 @@
 #include "Finder.h"
 
+#include <cstdlib> // abort
+#include <iostream>
+#include <utility> // pair
+
 namespace forward {
 
 const std::vector<primitives::point_id_t>& Finder::find_best()
+{
+    const StatsTimer timer;
+    reset_best();
+    const bool parallel {m_pool and m_strategy == Strategy::best};
+    if (m_incremental)
+    {
+        if (parallel)
+        {
+            find_forward_swap_active_parallel();
+        }
+        else
+        {
+            find_forward_swap_active();
+        }
+    }
+    else if (parallel)
+    {
+        find_forward_swap_parallel();
+    }
+    else if (m_strategy == Strategy::best)
+    {
+        for (size_t pass {0}; pass < pass_count(); ++pass)
+        {
+            find_forward_swap_sweep(pass);
+        }
+    }
+    else
+    {
+        find_forward_swap_resume();
+    }
+    finish_stats();
+    m_stats.find_best_seconds = timer.seconds();
+    return m_best_swap;
+}
+
+void Finder::reset_best()
 {
     m_best_swap.clear();
     m_best_improvement = 0;
     m_max_search_depth = 0;
-    find_forward_swap();
-    find_forward_swap_ab();
-    return m_best_swap;
+    m_stop = false;
+    m_start_key = 0;
+    m_best_key = std::numeric_limits<key_t>::max();
+    if constexpr (constants::search_stats)
+    {
+        m_stats.clear();
+        m_length_hits_start = m_length_map.hits();
+        m_length_misses_start = m_length_map.misses();
+    }
+}
+
+void Finder::finish_stats()
+{
+    count(m_stats.length_hits, m_length_map.hits() - m_length_hits_start);
+    count(m_stats.length_misses, m_length_map.misses() - m_length_misses_start);
+}
+
+void Finder::fix_edge(primitives::point_id_t a, primitives::point_id_t b)
+{
+    if (m_fixed.empty())
+    {
+        m_fixed.assign(m_tour.size(), {constants::invalid_point, constants::invalid_point});
+    }
+    for (auto [p, q] : {std::pair{a, b}, std::pair{b, a}})
+    {
+        auto& partners {m_fixed[p]};
+        if (partners[0] != constants::invalid_point and partners[1] != constants::invalid_point)
+        {
+            std::cout << __func__ << ": error: more than 2 fixed edges at point " << p << std::endl;
+            std::abort();
+        }
+        partners[partners[0] == constants::invalid_point ? 0 : 1] = q;
+    }
+}
+
+void Finder::use_candidates(const CandidateSet* candidates)
+{
+    if (candidates and not candidates->has_lengths())
+    {
+        std::cout << __func__ << ": error: candidate lengths were not computed." << std::endl;
+        std::abort();
+    }
+    m_candidates = candidates;
+}
+
+void Finder::threads(size_t count)
+{
+    m_pool.reset();
+    m_workers.clear();
+    m_worker_length_maps.clear();
+    if (count <= 1)
+    {
+        return;
+    }
+    m_pool = std::make_unique<ThreadPool>(count);
+    for (size_t w {1}; w < count; ++w)
+    {
+        // LengthMap caches are not thread-safe, so each worker gets an empty one of the same kind,
+        //  sharing the coordinates.
+        m_worker_length_maps.push_back(std::make_unique<LengthMap>(m_length_map
+            , m_length_map.cache(), m_length_map.cache_size()));
+        m_workers.push_back(std::make_unique<Finder>(m_tree, m_tour, *m_worker_length_maps.back()));
+    }
+}
+
+template <typename Search>
+void Finder::run_parallel(size_t count, const Search& search)
+{
+    for (size_t w {1}; w < m_pool->size(); ++w)
+    {
+        worker(w).m_candidates = m_candidates;
+        worker(w).m_both_directions = m_both_directions;
+        worker(w).m_fixed = m_fixed;
+        worker(w).reset_best();
+    }
+    m_pool->run(count, [this, &search](size_t w, size_t index) { search(worker(w), index); });
+    for (size_t w {1}; w < m_pool->size(); ++w)
+    {
+        auto& other {worker(w)};
+        if constexpr (constants::search_stats)
+        {
+            other.finish_stats();
+            m_stats.merge(other.m_stats);
+        }
+        m_max_search_depth = std::max(m_max_search_depth, other.m_max_search_depth);
+        if (other.m_best_swap.empty())
+        {
+            continue;
+        }
+        if (other.m_best_improvement > m_best_improvement
+            or (other.m_best_improvement == m_best_improvement and other.m_best_key < m_best_key))
+        {
+            m_best_swap = other.m_best_swap;
+            m_best_improvement = other.m_best_improvement;
+            m_restrict_even_best = other.m_restrict_even_best;
+            m_reversed_best = other.m_reversed_best;
+            m_best_key = other.m_best_key;
+        }
+    }
+}
+
+// Same search order as the sequential sweeps;
+//  task k searches pass k / n from the (k % n)-th start point.
+void Finder::find_forward_swap_parallel()
+{
+    m_starts = m_tour.order();
+    const auto n {m_starts.size()};
+    run_parallel(pass_count() * n, [this, n](Finder& finder, size_t k)
+    {
+        finder.m_start_key = k;
+        finder.find_forward_swap_pass(k / n, m_starts[k % n]);
+    });
+}
+
+// Same result as find_forward_swap_active with the best strategy.
+void Finder::find_forward_swap_active_parallel()
+{
+    m_starts.assign(std::cbegin(m_active_queue), std::cend(m_active_queue));
+    m_active_queue.clear();
+    m_starts_improve.assign(m_starts.size(), false);
+    run_parallel(m_starts.size(), [this](Finder& finder, size_t k)
+    {
+        const auto i {m_starts[k]};
+        finder.m_start_improves = false;
+        for (size_t pass {0}; pass < pass_count(); ++pass)
+        {
+            finder.m_start_key = pass_count() * k + pass;
+            finder.find_forward_swap_pass(pass, i);
+        }
+        m_starts_improve[k] = finder.m_start_improves;
+    });
+    for (size_t k {0}; k < m_starts.size(); ++k)
+    {
+        if (m_starts_improve[k])
+        {
+            m_active_queue.push_back(m_starts[k]);
+        }
+        else
+        {
+            m_active[m_starts[k]] = false;
+        }
+    }
+}
+
+void Finder::find_forward_swap_sweep(size_t pass)
+{
+    constexpr primitives::point_id_t start {0};
+    primitives::point_id_t i {start};
+    do
+    {
+        find_forward_swap_pass(pass, i);
+        i = m_tour.next(i);
+    } while (i != start);
+}
+
+void Finder::find_forward_swap_pass(size_t pass, primitives::point_id_t i)
+{
+    m_reversed = pass >= 2;
+    switch (pass)
+    {
+        case 0: find_forward_swap_from<false>(i); break;
+        case 1: find_forward_swap_ab_from<false>(i); break;
+        case 2: find_forward_swap_from<true>(i); break;
+        default: find_forward_swap_ab_from<true>(i);
+    }
+}
+
+void Finder::get_points(primitives::point_id_t i
+    , primitives::length_t radius
+    , std::vector<primitives::point_id_t>& points)
+{
+    const auto initial_size {points.size()};
+    const auto search_circle {m_tour.search_circle(i, radius)};
+    if (m_candidates)
+    {
+        for (auto p : m_candidates->neighbors(i))
+        {
+            if (not search_circle.contains(m_tour.x(p), m_tour.y(p)))
+            {
+                break; // candidates are sorted by distance.
+            }
+            points.push_back(p);
+        }
+    }
+    else
+    {
+        count(m_stats.tree_nodes, m_tree.get_points(i, search_circle, points));
+    }
+    count(m_stats.points, points.size() - initial_size);
 }
 
+void Finder::get_additions(primitives::point_id_t i
+    , primitives::length_t limit
+    , std::vector<primitives::point_id_t>& points
+    , std::vector<primitives::length_t>& lengths)
+{
+    if (not m_candidates)
+    {
+        get_points(i, limit, points);
+        return;
+    }
+    const auto neighbors {m_candidates->neighbors(i)};
+    const auto* neighbor_lengths {m_candidates->lengths(i)};
+    size_t additions {0};
+    if (m_candidates->lengths_sorted())
+    {
+        // candidates are sorted by distance, so the additions are a prefix.
+        while (additions < neighbors.size() and neighbor_lengths[additions] < limit)
+        {
+            ++additions;
+        }
+        points.insert(std::end(points), neighbors.begin(), neighbors.begin() + additions);
+        lengths.insert(std::end(lengths), neighbor_lengths, neighbor_lengths + additions);
+    }
+    else
+    {
+        // inexact storage can round lengths out of distance order, so every candidate is checked.
+        for (size_t k {0}; k < neighbors.size(); ++k)
+        {
+            if (neighbor_lengths[k] < limit)
+            {
+                points.push_back(neighbors.begin()[k]);
+                lengths.push_back(neighbor_lengths[k]);
+                ++additions;
+            }
+        }
+    }
+    count(m_stats.points, neighbors.size());
+    // the rest are pruned here, before their sequence is checked.
+    count(m_stats.pruned_gain, neighbors.size() - additions);
+}
+
+template <bool Reversed, bool RestrictEven, bool OddSize>
 void Finder::find_forward_swap(const primitives::point_id_t edge_start
     , const primitives::length_t removed_length
     , const primitives::length_t added_length)
 {
-    std::vector<primitives::point_id_t> points;
-    const auto length_margin {removed_length - added_length};
-    const auto remove {m_tour.length(edge_start)};
-    const auto search_box
+    if (m_candidates and m_current_swap.size() >= constants::candidate_max_swap_size)
     {
-        m_tour.search_box(edge_start, remove + length_margin + 1)
-    };
-    m_root.get_points(edge_start, search_box, points);
-    const auto minimum_sequence {m_tour.sequence(edge_start, m_swap_start) + 2};
-    for (auto p : points)
+        return;
+    }
+    auto& points {points_buffer(m_current_swap.size())};
+    auto& adds {lengths_buffer(m_current_swap.size())};
+    const auto max_branches {breadth(m_current_swap.size())};
+    size_t branches {0};
+    const auto length_margin {removed_length - added_length};
+    const auto remove {next_length<Reversed>(edge_start)};
+    // an added edge of length at least remove + length_margin cannot improve.
+    get_additions(edge_start, remove + length_margin, points, adds);
+    const auto minimum_sequence {sequence<Reversed>(edge_start) + 2};
+    for (size_t k {0}; k < points.size(); ++k)
     {
-        if (m_tour.sequence(p, m_swap_start) < minimum_sequence)
+        if (m_stop)
+        {
+            return;
+        }
+        const auto p {points[k]};
+        if (sequence<Reversed>(p) < minimum_sequence)
         {
+            count(m_stats.pruned_sequence);
             continue;
         }
-        const auto add {m_tour.length(p, edge_start)};
+        const auto add {addition_length(edge_start, points, adds, k)};
         if (added_length + add >= removed_length + remove)
         {
+            count(m_stats.pruned_gain);
             continue;
         }
+        if (fixed(p, pred<Reversed>(p)))
+        {
+            continue;
+        }
+        if (branches == max_branches)
+        {
+            return;
+        }
+        ++branches;
         m_current_swap.push_back(p);
+        count_node();
         m_max_search_depth = std::max(m_current_swap.size(), m_max_search_depth);
-        const auto new_start {m_tour.prev(p)};
-        const auto closing_remove {m_tour.length(new_start)};
+        const auto new_start {pred<Reversed>(p)};
+        const auto closing_remove {next_length<Reversed>(new_start)};
         const auto total_remove {removed_length + remove + closing_remove};
-        const auto closing_add {m_tour.length(m_swap_end, new_start)};
+        const auto closing_add {length(m_swap_end, new_start)};
         const auto total_add {closing_add + added_length + add};
         const bool improving {total_remove > total_add};
-        const bool odd_swap_size {(m_current_swap.size() & 1) == 1};
-        if (not m_restrict_even or odd_swap_size)
+        if constexpr (not RestrictEven or OddSize)
         {
             if (improving)
             {
                 check_best(total_remove - total_add);
             }
         }
-        find_forward_swap(new_start
+        // option 1 never tests the parity, so OddSize stays fixed to avoid redundant instantiations.
+        find_forward_swap<Reversed, RestrictEven, RestrictEven ? not OddSize : OddSize>(new_start
             , removed_length + remove
             , added_length + add);
         m_current_swap.pop_back();
     }
 }
 
-void Finder::find_forward_swap()
+template <bool Reversed>
+void Finder::find_forward_swap_from(primitives::point_id_t i)
 {
+    // option 1
+    if (fixed(i, pred<Reversed>(i)))
+    {
+        return;
+    }
     m_restrict_even = false;
-    constexpr primitives::point_id_t start {0};
-    primitives::point_id_t i {start};
     m_current_swap.clear();
-    do
+    const auto remove {prev_length<Reversed>(i)};
+    auto& points {points_buffer(0)};
+    auto& adds {lengths_buffer(0)};
+    get_additions(i, remove, points, adds);
+    m_swap_start = i;
+    m_swap_end = pred<Reversed>(i);
+    m_current_swap.push_back(i);
+    for (size_t k {0}; k < points.size(); ++k)
     {
-        // option 1
-        std::vector<primitives::point_id_t> points;
-        m_root.get_points(i, m_tour.search_box_prev(i), points);
-        m_swap_start = i;
-        m_swap_end = m_tour.prev(i);
-        m_current_swap.push_back(i);
-        const auto remove {m_tour.prev_length(i)};
-        for (auto p : points)
+        if (m_stop)
         {
-            if (p == i or p == m_tour.prev(i) or p == m_tour.next(i))
-            {
-                continue;
-            }
-            const auto add {m_tour.length(p, i)};
-            if (add >= remove)
-            {
-                continue;
-            }
-            const auto new_start {m_tour.prev(p)};
-            m_current_swap.push_back(p);
-            const auto next_remove {m_tour.prev_length(p)};
-            const auto total_remove {remove + next_remove};
-            const auto closing_add {m_tour.length(m_swap_end, new_start)};
-            const auto total_add {closing_add + add};
-            const auto improving {total_remove > total_add};
-            if (improving)
-            {
-                check_best(total_remove - total_add);
-            }
-            find_forward_swap(new_start, remove, add);
-            m_current_swap.pop_back();
+            break;
         }
-        i = m_tour.next(i);
+        const auto p {points[k]};
+        if (p == i or p == pred<Reversed>(i) or p == succ<Reversed>(i))
+        {
+            count(m_stats.pruned_sequence);
+            continue;
+        }
+        const auto add {addition_length(i, points, adds, k)};
+        if (add >= remove)
+        {
+            count(m_stats.pruned_gain);
+            continue;
+        }
+        if (fixed(p, pred<Reversed>(p)))
+        {
+            continue;
+        }
+        const auto new_start {pred<Reversed>(p)};
+        m_current_swap.push_back(p);
+        count_node();
+        const auto next_remove {prev_length<Reversed>(p)};
+        const auto total_remove {remove + next_remove};
+        const auto closing_add {length(m_swap_end, new_start)};
+        const auto total_add {closing_add + add};
+        const auto improving {total_remove > total_add};
+        if (improving)
+        {
+            check_best(total_remove - total_add);
+        }
+        find_forward_swap<Reversed, false, true>(new_start, remove, add);
         m_current_swap.pop_back();
-    } while (i != start);
+    }
+    m_current_swap.pop_back();
 }
 
 // For the first move, the first point in the first edge connects to the next point
 //  (as opposed to the second point in the first edge).
 // This means that the first move creates a cycle and cannot be closed
 //  (e.g. a 2-opt cannot be performed).
-void Finder::find_forward_swap_ab()
+template <bool Reversed>
+void Finder::find_forward_swap_ab_from(primitives::point_id_t i)
 {
+    // option 2
+    if (fixed(i, succ<Reversed>(i)))
+    {
+        return;
+    }
     m_restrict_even = true;
-    constexpr primitives::point_id_t start {0};
-    primitives::point_id_t i {start};
     m_current_swap.clear();
-    do
+    const auto remove {next_length<Reversed>(i)};
+    auto& points {points_buffer(0)};
+    auto& adds {lengths_buffer(0)};
+    get_additions(i, remove, points, adds);
+    m_swap_start = i;
+    m_swap_end = succ<Reversed>(i);
+    m_current_swap.push_back(i);
+    for (size_t k {0}; k < points.size(); ++k)
     {
-        // option 2
-        std::vector<primitives::point_id_t> points;
-        m_root.get_points(i, m_tour.search_box_next(i), points);
-        m_swap_start = i;
-        m_swap_end = m_tour.next(i);
-        m_current_swap.push_back(i);
-        const auto remove {m_tour.length(i)};
-        for (auto p : points)
+        if (m_stop)
+        {
+            break;
+        }
+        const auto p {points[k]};
+        if (p == i or p == pred<Reversed>(i) or p == succ<Reversed>(i))
+        {
+            count(m_stats.pruned_sequence);
+            continue;
+        }
+        const auto add {addition_length(i, points, adds, k)};
+        if (add >= remove)
+        {
+            count(m_stats.pruned_gain);
+            continue;
+        }
+        if (fixed(p, pred<Reversed>(p)))
         {
-            if (p == i or p == m_tour.prev(i) or p == m_tour.next(i))
+            continue;
+        }
+        m_current_swap.push_back(p);
+        count_node();
+        const auto new_start {pred<Reversed>(p)};
+        find_forward_swap<Reversed, true, true>(new_start, remove, add);
+        m_current_swap.pop_back();
+    }
+    m_current_swap.pop_back();
+}
+
+bool Finder::find_forward_swap_start(primitives::point_id_t i)
+{
+    m_start_improves = false;
+    for (size_t pass {0}; pass < pass_count() and not m_stop; ++pass)
+    {
+        find_forward_swap_pass(pass, i);
+    }
+    return m_start_improves;
+}
+
+void Finder::find_forward_swap_resume()
+{
+    if (m_resume_start >= m_tour.size())
+    {
+        m_resume_start = 0;
+    }
+    auto i {m_resume_start};
+    for (primitives::point_id_t searched {0}; searched < m_tour.size(); ++searched)
+    {
+        if (find_forward_swap_start(i))
+        {
+            // more improvements may start from i after this swap is applied.
+            m_resume_start = i;
+            return;
+        }
+        i = m_tour.next(i);
+    }
+}
+
+void Finder::find_forward_swap_active()
+{
+    // Start points without an improving swap are dropped from the queue.
+    if (m_strategy == Strategy::best)
+    {
+        const auto queue_size {m_active_queue.size()};
+        for (size_t k {0}; k < queue_size; ++k)
+        {
+            const auto i {m_active_queue.front()};
+            m_active_queue.pop_front();
+            if (find_forward_swap_start(i))
             {
-                continue;
+                m_active_queue.push_back(i);
             }
-            const auto add {m_tour.length(p, i)};
-            if (add >= remove)
+            else
             {
-                continue;
+                m_active[i] = false;
             }
-            m_current_swap.push_back(p);
-            const auto new_start {m_tour.prev(p)};
-            find_forward_swap(new_start, remove, add);
-            m_current_swap.pop_back();
         }
-        m_current_swap.pop_back();
+        return;
+    }
+    while (not m_active_queue.empty())
+    {
+        const auto i {m_active_queue.front()};
+        m_active_queue.pop_front();
+        if (find_forward_swap_start(i))
+        {
+            m_active_queue.push_front(i);
+            return;
+        }
+        m_active[i] = false;
+    }
+}
+
+void Finder::incremental(bool enable, bool activate_all)
+{
+    m_incremental = enable;
+    m_active.assign(m_tour.size(), false);
+    m_active_queue.clear();
+    if (not enable or not activate_all)
+    {
+        return;
+    }
+    constexpr primitives::point_id_t start {0};
+    primitives::point_id_t i {start};
+    do
+    {
+        activate(i);
         i = m_tour.next(i);
     } while (i != start);
 }
 
+void Finder::activate(primitives::point_id_t i)
+{
+    if (not m_active[i])
+    {
+        m_active[i] = true;
+        m_active_queue.push_back(i);
+    }
+}
 
-} // namespace forward
+void Finder::activate_neighborhood(const std::vector<primitives::point_id_t>& points)
+{
+    if (not m_incremental)
+    {
+        return;
+    }
+    auto& neighbors {points_buffer(0)};
+    for (auto p : points)
+    {
+        activate(p);
+        neighbors.clear();
+        get_points(p, std::max(next_length(p), prev_length(p)), neighbors);
+        for (auto n : neighbors)
+        {
+            activate(n);
+        }
+    }
+}
 
+} // namespace forward
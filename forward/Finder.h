@@ -1,7 +1,7 @@
 #pragma once
 
 // Finds best-improvement forward swap.
-// Does not modify tour, but Tour has length computer that records queried lengths.
+// Does not modify tour, but queries lengths through a LengthMap that may cache them.
 
 // If the "first" (direction of traversal) point of any edge is "a"
 //  and the second point is "b", then the first move can be made of either:
@@ -14,10 +14,59 @@
 //  downstream / later in the tour, and all moves (except the first)
 //  must go from a to b (of the next destroyed edge).
 
-#include <point_quadtree/Node.h>
+// Forward swaps are searched in both traversal directions: the reversed direction
+//  swaps the roles of next and prev, and sequence numbers count backwards from the
+//  swap start. The tour itself is not reversed; see Tour::forward_swap.
+
+// In incremental mode ("don't-look bits"), only active start points are searched.
+// A start point is deactivated when no improving swap starts from it, and is
+//  reactivated when an edge at or near it changes (activate_neighborhood).
+// This skips unchanged regions near convergence, but is no longer exhaustive.
+
+// The search strategy decides when find_best returns:
+//  best: the best swap over all (active) start points.
+//  first: the first improving swap found.
+//  neighborhood: the best swap from the first start point that has an improving swap.
+// first and neighborhood resume from the start point where the previous call stopped.
+
+// With threads(n > 1), the best strategy searches start points in parallel.
+// Each worker is a Finder with its own LengthMap cache and search buffers; the tour,
+//  tree, candidate set and coordinates are only read. Ties between equally improving swaps
+//  are broken by start point order (option 1 sweep, then option 2 sweep, or
+//  active queue order), so the result is the same as a single-threaded search.
+// first and neighborhood stop at the first improving start point and stay single-threaded.
+
+// Fixed edges (see fix_edge) are never removed, so paths between them keep their
+//  endpoints; this lets a path of a larger tour be optimized as a cycle closed by a fixed edge.
+
+// If constants::search_stats, search work of each find_best call is counted (see Stats.h).
+
+// By default, candidate points come from quadtree radius queries, which considers
+//  every possible improving addition. If a CandidateSet is given, only those candidates
+//  are considered, which bounds the work per point but is no longer exhaustive.
+// Lengths from each point to its candidates are computed once per CandidateSet, as one
+//  batch per point (CandidateSet::compute_lengths), and shared by all Finders using it.
+//  Candidates are sorted by distance, so the search takes the prefix that can improve
+//  and reads its lengths, with no length query per candidate. If the stored lengths
+//  are not in that order (CandidateSet::lengths_sorted), every candidate is checked.
+// With a CandidateSet, swaps are also bounded in size (constants::candidate_max_swap_size),
+//  and each partial swap extends to at most constants::candidate_breadth additions,
+//  so the work per start point is bounded.
+// Lengths to quadtree query points are queried on demand, as most of them are not
+//  downstream of the current edge.
+
+#include "Stats.h"
+#include <CandidateSet.h>
+#include <LengthMap.h>
+#include <ThreadPool.h>
+#include <point_quadtree/Tree.h>
 #include <Tour.h>
 #include <primitives.h>
 
+#include <array>
+#include <deque>
+#include <limits>
+#include <memory> // unique_ptr
 #include <vector>
 
 namespace forward {
@@ -25,42 +74,234 @@ namespace forward {
 class Finder
 {
 public:
-    Finder(const point_quadtree::Node& root, Tour& tour) : m_root(root), m_tour(tour) {}
+    enum class Strategy { best, first, neighborhood };
+
+    Finder(const point_quadtree::Tree& tree, Tour& tour) : Finder(tree, tour, tour.length_map()) {}
+    // Lengths are queried from length_map instead of the tour's.
+    Finder(const point_quadtree::Tree& tree, const Tour& tour, LengthMap& length_map)
+        : m_tree(tree), m_tour(tour), m_length_map(length_map) {}
+
+    // Number of threads searching start points (including the calling thread).
+    void threads(size_t count);
+
+    void strategy(Strategy strategy) { m_strategy = strategy; }
+
+    // candidates can be null to return to quadtree queries; otherwise their lengths
+    //  must have been computed (CandidateSet::compute_lengths).
+    void use_candidates(const CandidateSet* candidates);
+
+    // Edge (a, b) will not be removed by any swap. A point can have up to 2 fixed edges.
+    void fix_edge(primitives::point_id_t a, primitives::point_id_t b);
+
+    // If false, only the tour's forward direction is searched.
+    void both_directions(bool enable) { m_both_directions = enable; }
+
+    // Initially activates all points, unless activate_all is false
+    //  (e.g. at a local optimum, where only points near later changes need searching).
+    void incremental(bool enable, bool activate_all = true);
+    // Activates points and their spatial neighbors (within the longer adjacent tour edge).
+    // Call after a tour modification with the endpoints of changed edges.
+    void activate_neighborhood(const std::vector<primitives::point_id_t>& points);
+    size_t active_count() const { return m_active_queue.size(); }
 
     const std::vector<primitives::point_id_t>& find_best();
     const std::vector<primitives::point_id_t>& best() const { return m_best_swap; }
     bool restrict_even_best() const { return m_restrict_even_best; }
+    bool reversed_best() const { return m_reversed_best; }
     size_t max_search_depth() const { return m_max_search_depth; }
+    // Of the last find_best call, including all threads.
+    const Stats& stats() const { return m_stats; }
 
 private:
-    const point_quadtree::Node& m_root;
-    Tour& m_tour;
+    using key_t = uint64_t;
+
+    const point_quadtree::Tree& m_tree;
+    const Tour& m_tour;
+    LengthMap& m_length_map;
+    const CandidateSet* m_candidates {nullptr};
+    Strategy m_strategy {Strategy::best};
+    primitives::point_id_t m_resume_start {0}; // first start point searched by first / neighborhood.
+    bool m_stop {false}; // if the search should unwind (first improvement found).
+    bool m_both_directions {true};
+    // Fixed edge partners of each point (invalid_point if none); empty if no edges are fixed.
+    std::vector<std::array<primitives::point_id_t, 2>> m_fixed;
 
     // for each point p in swap vector, edge (p, prev(p)) is deleted.
     std::vector<primitives::point_id_t> m_current_swap;
     std::vector<primitives::point_id_t> m_best_swap;
     primitives::length_t m_best_improvement {0};
     bool m_restrict_even_best {false};
+    bool m_reversed_best {false};
     size_t m_max_search_depth {0};
+    // Search order of the current start point and of the best swap, for tie-breaking.
+    key_t m_start_key {0};
+    key_t m_best_key {std::numeric_limits<key_t>::max()};
+
+    Stats m_stats;
+    uint64_t m_length_hits_start {0};
+    uint64_t m_length_misses_start {0};
 
     primitives::point_id_t m_swap_start {constants::invalid_point};
     primitives::point_id_t m_swap_end {constants::invalid_point};
     // If the first move is a to b, even-numbered k-opt moves will split the tour.
     // if true, even-numbered k-opt moves are prohibited from m_swap.
     bool m_restrict_even {false};
+    // If the current search traverses the tour in the reversed direction.
+    bool m_reversed {false};
+
+    bool m_incremental {false};
+    std::vector<bool> m_active;
+    std::deque<primitives::point_id_t> m_active_queue;
+    bool m_start_improves {false}; // if an improving swap was found from the current start point.
+
+    // Parallel search; worker 0 is this Finder.
+    std::unique_ptr<ThreadPool> m_pool;
+    std::vector<std::unique_ptr<LengthMap>> m_worker_length_maps;
+    std::vector<std::unique_ptr<Finder>> m_workers;
+    std::vector<primitives::point_id_t> m_starts; // start points in search order.
+    std::vector<char> m_starts_improve; // per entry of m_starts.
+
+    // Candidate point buffers reused across sweeps, indexed by search depth (swap size).
+    // deque keeps references to shallower buffers valid while deeper ones are added.
+    std::deque<std::vector<primitives::point_id_t>> m_points;
+    // Lengths of the candidate points (from a CandidateSet), per depth.
+    std::deque<std::vector<primitives::length_t>> m_lengths;
+
+    template <typename T>
+    static std::vector<T>& buffer(std::deque<std::vector<T>>& buffers, size_t depth)
+    {
+        while (buffers.size() <= depth)
+        {
+            buffers.emplace_back();
+        }
+        auto& values {buffers[depth]};
+        values.clear();
+        return values;
+    }
+    std::vector<primitives::point_id_t>& points_buffer(size_t depth) { return buffer(m_points, depth); }
+    std::vector<primitives::length_t>& lengths_buffer(size_t depth) { return buffer(m_lengths, depth); }
+    void count(uint64_t& counter, uint64_t amount = 1)
+    {
+        if constexpr (constants::search_stats)
+        {
+            counter += amount;
+        }
+    }
+    // Counts a recursion node at the current swap size.
+    void count_node()
+    {
+        if constexpr (constants::search_stats)
+        {
+            m_stats.count_node(m_current_swap.size());
+        }
+    }
+    // Adds LengthMap counts since reset_best.
+    void finish_stats();
+    primitives::length_t length(primitives::point_id_t a, primitives::point_id_t b)
+    {
+        return m_length_map.length(a, b);
+    }
+    // Traversal in a search direction; the versions without Reversed use the current one.
+    template <bool Reversed>
+    primitives::point_id_t succ(primitives::point_id_t i) const
+    {
+        return Reversed ? m_tour.prev(i) : m_tour.next(i);
+    }
+    template <bool Reversed>
+    primitives::point_id_t pred(primitives::point_id_t i) const
+    {
+        return Reversed ? m_tour.next(i) : m_tour.prev(i);
+    }
+    // Number of succ steps from m_swap_start to i.
+    template <bool Reversed>
+    primitives::point_id_t sequence(primitives::point_id_t i) const
+    {
+        return Reversed ? m_tour.sequence(m_swap_start, i) : m_tour.sequence(i, m_swap_start);
+    }
+    primitives::point_id_t succ(primitives::point_id_t i) const { return m_reversed ? succ<true>(i) : succ<false>(i); }
+    primitives::point_id_t pred(primitives::point_id_t i) const { return m_reversed ? pred<true>(i) : pred<false>(i); }
+    bool fixed(primitives::point_id_t a, primitives::point_id_t b) const
+    {
+        return not m_fixed.empty() and (m_fixed[a][0] == b or m_fixed[a][1] == b);
+    }
+    template <bool Reversed>
+    primitives::length_t next_length(primitives::point_id_t i) { return length(i, succ<Reversed>(i)); }
+    template <bool Reversed>
+    primitives::length_t prev_length(primitives::point_id_t i) { return length(i, pred<Reversed>(i)); }
+    primitives::length_t next_length(primitives::point_id_t i) { return length(i, succ(i)); }
+    primitives::length_t prev_length(primitives::point_id_t i) { return length(i, pred(i)); }
 
+    // Appends points within radius of i.
+    void get_points(primitives::point_id_t i
+        , primitives::length_t radius
+        , std::vector<primitives::point_id_t>& points);
+    // Appends the points that i can be connected to by an edge shorter than limit:
+    //  candidates and their lengths, or quadtree points within limit of i (lengths not appended).
+    void get_additions(primitives::point_id_t i
+        , primitives::length_t limit
+        , std::vector<primitives::point_id_t>& points
+        , std::vector<primitives::length_t>& lengths);
+    // Most additions searched from a partial swap of swap_size removed edges.
+    size_t breadth(size_t swap_size) const
+    {
+        if (not m_candidates)
+        {
+            return std::numeric_limits<size_t>::max();
+        }
+        const auto level {swap_size - 2};
+        return level < constants::candidate_breadth.size() ? constants::candidate_breadth[level] : 1;
+    }
+    // Length from i to the k-th point returned by get_additions.
+    primitives::length_t addition_length(primitives::point_id_t i
+        , const std::vector<primitives::point_id_t>& points
+        , const std::vector<primitives::length_t>& lengths
+        , size_t k)
+    {
+        return m_candidates ? lengths[k] : length(points[k], i);
+    }
+    // Search kernels are instantiated per direction (Reversed), and the recursion also per
+    //  first move option (RestrictEven) and, for option 2, parity of the swap size after
+    //  adding a point (OddSize), so none of these are tested per candidate point.
+    // Option 1 always passes OddSize = true.
+    template <bool Reversed, bool RestrictEven, bool OddSize>
     void find_forward_swap(const primitives::point_id_t edge_start
         , const primitives::length_t removed_length
         , const primitives::length_t added_length);
-    void find_forward_swap();
-    void find_forward_swap_ab();
+    // A pass is one combination of direction and first move option, in search order:
+    //  forward option 1, forward option 2, reversed option 1, reversed option 2.
+    size_t pass_count() const { return m_both_directions ? 4 : 2; }
+    void find_forward_swap_pass(size_t pass, primitives::point_id_t i);
+    // Searches one pass from every start point.
+    void find_forward_swap_sweep(size_t pass);
+    template <bool Reversed>
+    void find_forward_swap_from(primitives::point_id_t i);
+    template <bool Reversed>
+    void find_forward_swap_ab_from(primitives::point_id_t i);
+    void find_forward_swap_active();
+    void find_forward_swap_resume();
+    // Searches both options from start point i; returns true if an improving swap was found.
+    bool find_forward_swap_start(primitives::point_id_t i);
+    void activate(primitives::point_id_t i);
+    void reset_best();
+    Finder& worker(size_t w) { return w == 0 ? *this : *m_workers[w - 1]; }
+    // Runs search(finder, index) over [0, count) on all workers and collects the best swap.
+    template <typename Search>
+    void run_parallel(size_t count, const Search& search);
+    void find_forward_swap_parallel();
+    void find_forward_swap_active_parallel();
     void check_best(primitives::length_t improvement)
     {
-        if (improvement > m_best_improvement)
+        m_start_improves = true;
+        m_stop = m_strategy == Strategy::first;
+        if (improvement > m_best_improvement
+            or (improvement == m_best_improvement and m_start_key < m_best_key))
         {
-            m_best_swap = m_current_swap;
+            // reuses existing capacity.
+            m_best_swap.assign(std::cbegin(m_current_swap), std::cend(m_current_swap));
             m_best_improvement = improvement;
             m_restrict_even_best = m_restrict_even;
+            m_reversed_best = m_reversed;
+            m_best_key = m_start_key;
         }
     }
 };
@@ -0,0 +1,97 @@
+#pragma once
+
+// Search work counters of one find_best call, enabled by constants::search_stats.
+// When disabled, Finder never touches them and they stay zero.
+// Written as one JSON object per line (JSON lines), one line per iteration.
+
+#include <constants.h>
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace forward {
+
+struct Stats
+{
+    uint64_t tree_nodes {0}; // quadtree nodes visited by radius queries.
+    uint64_t points {0}; // candidate points returned by radius queries or candidate sets.
+    uint64_t pruned_sequence {0}; // candidates not downstream of the current edge.
+    uint64_t pruned_gain {0}; // candidates whose added edge cannot improve.
+    std::vector<uint64_t> depth_nodes; // recursion nodes (partial swaps) per swap size.
+    uint64_t length_hits {0};
+    uint64_t length_misses {0};
+    double find_best_seconds {0};
+
+    void clear() { *this = Stats(); }
+    void count_node(size_t depth)
+    {
+        if (depth_nodes.size() <= depth)
+        {
+            depth_nodes.resize(depth + 1);
+        }
+        ++depth_nodes[depth];
+    }
+    void merge(const Stats& other)
+    {
+        tree_nodes += other.tree_nodes;
+        points += other.points;
+        pruned_sequence += other.pruned_sequence;
+        pruned_gain += other.pruned_gain;
+        if (depth_nodes.size() < other.depth_nodes.size())
+        {
+            depth_nodes.resize(other.depth_nodes.size());
+        }
+        for (size_t i {0}; i < other.depth_nodes.size(); ++i)
+        {
+            depth_nodes[i] += other.depth_nodes[i];
+        }
+        length_hits += other.length_hits;
+        length_misses += other.length_misses;
+    }
+
+    // Writes the members of a JSON object, without braces.
+    void write_json(std::ostream& out) const
+    {
+        out << "\"find_best_seconds\": " << find_best_seconds
+            << ", \"tree_nodes\": " << tree_nodes
+            << ", \"points\": " << points
+            << ", \"pruned_sequence\": " << pruned_sequence
+            << ", \"pruned_gain\": " << pruned_gain
+            << ", \"length_hits\": " << length_hits
+            << ", \"length_misses\": " << length_misses
+            << ", \"depth_nodes\": [";
+        for (size_t i {0}; i < depth_nodes.size(); ++i)
+        {
+            out << (i == 0 ? "" : ", ") << depth_nodes[i];
+        }
+        out << "]";
+    }
+};
+
+// Seconds since construction; nothing is measured unless constants::search_stats.
+class StatsTimer
+{
+public:
+    StatsTimer()
+    {
+        if constexpr (constants::search_stats)
+        {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+    double seconds() const
+    {
+        if constexpr (constants::search_stats)
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        }
+        return 0;
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace forward
@@ -1,60 +1,413 @@
+#include "CandidateSet.h"
+#include "Checkpointer.h"
 #include "LengthMap.h"
 #include "Tour.h"
+#include "binaryio.h"
+#include "construction.h"
 #include "fileio.h"
 #include "point_quadtree/Domain.h"
-#include "point_quadtree/Node.h"
+#include "point_quadtree/Tree.h"
 #include "point_quadtree/morton_keys.h"
 #include "point_quadtree/point_quadtree.h"
 #include "forward/Finder.h"
+#include "multistart.h"
+#include "or_opt/Optimizer.h"
+#include "partition/Solver.h"
+#include "perturbation/DoubleBridge.h"
+#include "options.h"
 
+#include <algorithm> // stable_sort
+#include <cmath> // hypot
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory> // unique_ptr
+#include <utility> // move
+
+namespace {
+
+// If the point count and every tour length fit the point id and length widths of this build.
+bool fits_widths(size_t point_count, const point_quadtree::Domain& domain)
+{
+    if (point_count > constants::max_point_count)
+    {
+        std::cout << "Too many points (" << point_count << ") for " << 8 * sizeof(primitives::point_id_t)
+            << "-bit point ids; at most " << constants::max_point_count << " are supported." << std::endl;
+        return false;
+    }
+    // Edges are at most the domain diagonal (rounded up); searches add at most one more.
+    const auto longest_edge {std::hypot(domain.xdim(0), domain.ydim(0)) + 1};
+    if ((point_count + 1) * longest_edge >= std::numeric_limits<primitives::length_t>::max())
+    {
+        std::cout << "Tour lengths may not fit " << 8 * sizeof(primitives::length_t)
+            << "-bit lengths; use a build with wider lengths." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
 
 int main(int argc, const char** argv)
 {
-    if (argc < 2)
+    const options::Options options(argc, argv);
+    if (options.positional().empty())
     {
-        std::cout << "Arguments: point_set_file_path optional_tour_file_path" << std::endl;
+        std::cout << "Arguments: point_set_file_path optional_tour_file_path [options]\n"
+            << "    Files can be TSPLIB text or binary (see convert.out).\n"
+            << "Options:\n"
+            << "    --initial_tour=file|morton|hilbert|nearest|greedy: tour file (or file order if none given),\n"
+            << "        space-filling curve, nearest-neighbor or greedy-edge construction (default: file)\n"
+            << "    --length_cache=none|flat|neighbor (default: none)\n"
+            << "    --length_cache_size=entries (flat) or slots per point (neighbor)\n"
+            << "    --coordinates=double|int32|float32: coordinate storage for length computation (default: double);\n"
+            << "        narrow storages copy the coordinates, so they add memory but read less per length\n"
+            << "    --candidates=K: search only the K nearest neighbors of each point (default: 0, exhaustive quadtree search)\n"
+            << "    --quadrant_candidates=Q: also search the Q nearest neighbors in each quadrant (default: 0)\n"
+            << "    --incremental=off|on: only search from points near recent changes (default: off)\n"
+            << "    --strategy=best|first|neighborhood: apply the best swap over all start points,\n"
+            << "        the first improving swap, or the best swap from one start point (default: best)\n"
+            << "    --directions=both|forward: tour traversal directions searched (default: both)\n"
+            << "    --or_opt=off|pre|interleaved: move paths of up to " << constants::or_opt_max_segment
+            << " points before forward swaps,\n"
+            << "        or before every forward swap search (default: off)\n"
+            << "    --save_period=N: minimum improvements between checkpoints (default: " << constants::save_period << ")\n"
+            << "    --save_seconds=S: minimum seconds between checkpoints (default: " << constants::save_seconds << ")\n"
+            << "    --resume=off|on: start from the shortest checkpoint in ./saves for these coordinates, if any (default: off)\n"
+            << "    --threads=N: search start points on N threads (best strategy only; default: 1)\n"
+            << "    --kicks=N: after the first local optimum, apply up to N random double-bridge kicks,\n"
+            << "        each followed by re-optimization near the kick; worse tours are rolled back (default: 0)\n"
+            << "    --kick_seconds=S: stop kicking after S seconds (default: 0, no limit; either option enables kicks)\n"
+            << "    --seed=N: random seed for kicks (default: 0)\n"
+            << "    --starts=N: optimize N initial tours in parallel (this one, greedy, nearest, skipping repeated tours,\n"
+            << "        then perturbed repeats seeded by seed + start), merge them, and search where they differ (default: 1)\n"
+            << "    --partition=off|pre|only: optimize tour paths inside quadtree tiles in parallel\n"
+            << "        before the whole-tour search, or instead of it (default: off)\n"
+            << "    --tile_points=N: average points per partition tile (default: " << constants::partition_tile_points << ")\n"
+            << "    --partition_rounds=N: maximum partition rounds (default: " << constants::partition_rounds << ")\n"
+            << "    --stats_file=path: per-iteration search statistics as JSON lines (default: stats.jsonl;\n"
+            << "        only written if built with constants::search_stats)\n"
+            << std::endl;
         return 0;
     }
+    options.check_names({"initial_tour", "length_cache", "length_cache_size", "coordinates", "candidates"
+        , "quadrant_candidates", "incremental", "strategy", "directions", "or_opt", "save_period", "save_seconds"
+        , "resume", "threads", "kicks", "kick_seconds", "seed", "starts", "partition", "tile_points"
+        , "partition_rounds", "stats_file"});
 
     // Read input files.
-    const auto coordinates {fileio::read_coordinates(argv[1])};
-    const auto& x {coordinates[0]};
-    const auto& y {coordinates[1]};
-    const auto initial_tour = fileio::initial_tour(argc, argv, x.size());
+    binaryio::PointSet points;
+    if (binaryio::is_binary(options.positional(0)))
+    {
+        points = binaryio::read_points(options.positional(0));
+    }
+    else
+    {
+        auto coordinates {fileio::read_coordinates(options.positional(0), options.get_size("threads", 1))};
+        points.x = std::move(coordinates[0]);
+        points.y = std::move(coordinates[1]);
+    }
+    const auto& x {points.x};
+    const auto& y {points.y};
+    point_quadtree::Domain domain(x, y);
+    if (not fits_widths(x.size(), domain))
+    {
+        return 1;
+    }
+
+    // Quad tree.
+    const auto morton_keys {points.morton_keys.empty()
+        ? point_quadtree::morton_keys::compute_point_morton_keys(x, y, domain) : std::move(points.morton_keys)};
+    const point_quadtree::Tree tree(x, y, morton_keys, domain);
+
+    // Initial tour.
+    const std::string save_directory {"./saves"};
+    const auto instance_key {Checkpointer::instance_key(x, y)};
+    const auto checkpoint {options.get_choice("resume", {"off", "on"}, 0) == 1 ? Checkpointer::latest(save_directory, instance_key) : ""};
+    const auto tour_file_path {checkpoint.empty() ? options.positional(1) : checkpoint.c_str()};
+    const auto constructor {checkpoint.empty()
+        ? options.get_choice("initial_tour", {"file", "morton", "hilbert", "nearest", "greedy"}, 0) : 0};
+    std::vector<primitives::point_id_t> initial_tour;
+    switch (constructor)
+    {
+        case 1: initial_tour = construction::morton(tree); break;
+        case 2: initial_tour = construction::hilbert(x, y, domain); break;
+        case 3: initial_tour = construction::nearest_neighbor(tree); break;
+        case 4: initial_tour = construction::greedy(x, y, tree, domain); break;
+        default:
+            initial_tour = tour_file_path and binaryio::is_binary(tour_file_path)
+                ? binaryio::read_tour(tour_file_path)
+                : fileio::initial_tour(tour_file_path, x.size());
+    }
+    if (initial_tour.size() != x.size())
+    {
+        std::cout << "Tour size (" << initial_tour.size() << ") does not match point count ("
+            << x.size() << ")." << std::endl;
+        return 1;
+    }
 
     // Distance calculation.
-    point_quadtree::Domain domain(x, y);
-    LengthMap length_map(x, y);
+    const auto length_cache {static_cast<LengthMap::Cache>(
+        options.get_choice("length_cache", {"none", "flat", "neighbor"}, 0))};
+    const auto storage {static_cast<LengthMap::Storage>(
+        options.get_choice("coordinates", {"double", "int32", "float32"}, 0))};
+    LengthMap length_map(x, y, length_cache, options.get_size("length_cache_size", 0), storage);
+    if (storage == LengthMap::Storage::int32 and length_map.storage() != storage)
+    {
+        std::cout << "Coordinates are not integers within 2^26 of each other; using double storage." << std::endl;
+    }
+    if (not length_map.exact())
+    {
+        std::cout << "Coordinates are not exact as float32; lengths may differ from double storage." << std::endl;
+    }
+
+    // Partitioned solve; candidates, length cache, coordinate storage, strategy, incremental
+    //  and directions apply to each tile path.
+    const auto partition_mode {options.get_choice("partition", {"off", "pre", "only"}, 0)};
+    bool improved {false}; // if the initial tour was improved before the search.
+    if (partition_mode != 0)
+    {
+        partition::Settings settings;
+        settings.tile_points = options.get_size("tile_points", constants::partition_tile_points);
+        settings.candidates = options.get_size("candidates", 0);
+        settings.strategy = static_cast<forward::Finder::Strategy>(
+            options.get_choice("strategy", {"best", "first", "neighborhood"}, 0));
+        settings.incremental = options.get_choice("incremental", {"off", "on"}, 0) == 1;
+        settings.both_directions = options.get_choice("directions", {"both", "forward"}, 0) == 0;
+        partition::Solver solver(x, y, domain, settings, options.get_size("threads", 1));
+        const auto rounds {options.get_size("partition_rounds", constants::partition_rounds)};
+        // Stops when neither grid offset improves.
+        size_t unimproved {0};
+        for (size_t round {0}; round < rounds and unimproved < 2; ++round)
+        {
+            const auto improvement {solver.round(initial_tour, round % 2 == 1)};
+            std::cout << "partition round, paths, improvement: " << round
+                << ", " << solver.path_count()
+                << ", " << improvement << std::endl;
+            unimproved = improvement == 0 ? unimproved + 1 : 0;
+            improved = improved or improvement > 0;
+        }
+    }
+
+    std::unique_ptr<CandidateSet> candidates;
+    const auto nearest_candidates {options.get_size("candidates", 0)};
+    const auto quadrant_candidates {options.get_size("quadrant_candidates", 0)};
+    if (nearest_candidates > 0 or quadrant_candidates > 0)
+    {
+        candidates = std::make_unique<CandidateSet>(x, y, tree, domain
+            , nearest_candidates, quadrant_candidates);
+        candidates->compute_lengths(length_map);
+        std::cout << "Candidate set size: " << candidates->size() << std::endl;
+    }
+    const auto or_opt_mode {options.get_choice("or_opt", {"off", "pre", "interleaved"}, 0)};
+    const auto kicks {options.get_size("kicks", 0)};
+    const auto kick_seconds {options.get_size("kick_seconds", 0)};
+
+    // Multi-start; the merged tour keeps edges shared by all starts.
+    const auto starts {options.get_size("starts", 1)};
+    std::vector<std::pair<primitives::point_id_t, primitives::point_id_t>> shared_edges;
+    if (starts > 1)
+    {
+        multistart::Settings settings;
+        settings.starts = starts;
+        settings.candidates = candidates.get();
+        settings.strategy = static_cast<forward::Finder::Strategy>(
+            options.get_choice("strategy", {"best", "first", "neighborhood"}, 0));
+        settings.incremental = options.get_choice("incremental", {"off", "on"}, 0) == 1;
+        settings.both_directions = options.get_choice("directions", {"both", "forward"}, 0) == 0;
+        settings.or_opt_mode = or_opt_mode;
+        settings.kicks = kicks;
+        settings.kick_seconds = kick_seconds;
+        settings.seed = options.get_size("seed", 0);
+        const auto tours {multistart::run(length_map, tree, domain, initial_tour, settings, options.get_size("threads", 1))};
+        const auto tour_length = [&length_map](const std::vector<primitives::point_id_t>& tour)
+        {
+            primitives::length_t length {0};
+            for (size_t i {0}; i < tour.size(); ++i)
+            {
+                length += length_map.length(tour[i], tour[i + 1 == tour.size() ? 0 : i + 1]);
+            }
+            return length;
+        };
+        // tour_length is O(n), so each length is computed once.
+        std::vector<primitives::length_t> lengths(starts);
+        std::vector<size_t> by_length(starts);
+        for (size_t start {0}; start < starts; ++start)
+        {
+            lengths[start] = tour_length(tours[start]);
+            by_length[start] = start;
+            std::cout << "start, length: " << start << ", " << lengths[start] << std::endl;
+        }
+        std::stable_sort(std::begin(by_length), std::end(by_length)
+            , [&lengths](auto a, auto b) { return lengths[a] < lengths[b]; });
+        auto merged {tours[by_length.front()]};
+        for (auto it {std::cbegin(by_length) + 1}; it != std::cend(by_length); ++it)
+        {
+            merged = multistart::merge(merged, tours[*it], length_map);
+        }
+        const auto merged_length {tour_length(merged)};
+        std::cout << "merged length: " << merged_length << std::endl;
+        improved = improved or merged_length < tour_length(initial_tour);
+        shared_edges = multistart::shared_edges(merged, tours);
+        initial_tour = std::move(merged);
+    }
+
     Tour tour(initial_tour, &length_map);
     std::cout << "Initial tour length: " << tour.length() << std::endl;
 
-    // Quad tree.
-    const auto morton_keys
-        {point_quadtree::morton_keys::compute_point_morton_keys(x, y, domain)};
-    Box box;
-    box.xmin = domain.xmin();
-    box.ymin = domain.ymin();
-    box.xmax = domain.xmin() + domain.xdim(0);
-    box.ymax = domain.ymin() + domain.ydim(0);
-    point_quadtree::Node root(box);
-    point_quadtree::initialize_points(root, morton_keys, domain);
-
-    forward::Finder finder(root, tour);
-    while (finder.find_best().size() > 0)
-    {
-        std::cout << "best k, max search depth, restrict even: "
+    forward::Finder finder(tree, tour);
+    finder.use_candidates(candidates.get());
+    or_opt::Optimizer or_optimizer(tree, tour);
+    or_optimizer.use_candidates(candidates.get());
+    finder.strategy(static_cast<forward::Finder::Strategy>(
+        options.get_choice("strategy", {"best", "first", "neighborhood"}, 0)));
+    finder.incremental(options.get_choice("incremental", {"off", "on"}, 0) == 1);
+    finder.both_directions(options.get_choice("directions", {"both", "forward"}, 0) == 0);
+    finder.threads(options.get_size("threads", 1));
+    if (starts > 1)
+    {
+        // Only search where the starts differ.
+        std::vector<int> fixed_count(x.size(), 0);
+        for (const auto& [a, b] : shared_edges)
+        {
+            finder.fix_edge(a, b);
+            or_optimizer.fix_edge(a, b);
+            ++fixed_count[a];
+            ++fixed_count[b];
+        }
+        std::vector<primitives::point_id_t> differing;
+        for (primitives::point_id_t p {0}; p < x.size(); ++p)
+        {
+            if (fixed_count[p] < 2)
+            {
+                differing.push_back(p);
+            }
+        }
+        finder.incremental(true, false);
+        finder.activate_neighborhood(differing);
+        or_optimizer.activate_only(differing);
+    }
+    std::unique_ptr<Checkpointer> checkpointer;
+    if (constants::write_best)
+    {
+        checkpointer = std::make_unique<Checkpointer>(save_directory, instance_key
+            , options.get_size("save_period", constants::save_period)
+            , options.get_size("save_seconds", constants::save_seconds));
+    }
+    std::ofstream stats_file;
+    if constexpr (constants::search_stats)
+    {
+        stats_file.open(options.get("stats_file", "stats.jsonl"));
+    }
+    size_t iteration {0};
+    // k is 0 for the last find_best call, which found no improving swap.
+    const auto write_stats = [&](double forward_swap_seconds)
+    {
+        if constexpr (constants::search_stats)
+        {
+            stats_file << "{\"iteration\": " << iteration
+                << ", \"length\": " << tour.length()
+                << ", \"k\": " << finder.best().size()
+                << ", \"max_search_depth\": " << finder.max_search_depth()
+                << ", \"forward_swap_seconds\": " << forward_swap_seconds
+                << ", ";
+            finder.stats().write_json(stats_file);
+            stats_file << "}" << std::endl; // flushed, so stalled runs can be inspected.
+        }
+    };
+    if (checkpointer and improved)
+    {
+        checkpointer->offer(tour);
+    }
+    const auto run_or_opt = [&]()
+    {
+        const auto moves {or_optimizer.optimize()};
+        if (moves > 0)
+        {
+            std::cout << "or-opt moves, length: " << moves << ", " << tour.length() << std::endl;
+            finder.activate_neighborhood(or_optimizer.changed());
+        }
+    };
+    const bool search {partition_mode != 2};
+    if (search and or_opt_mode == 1)
+    {
+        run_or_opt();
+    }
+    while (search)
+    {
+        if (or_opt_mode == 2)
+        {
+            run_or_opt();
+        }
+        if (finder.find_best().empty())
+        {
+            write_stats(0);
+            break;
+        }
+        std::cout << "best k, max search depth, restrict even, reversed: "
             << finder.best().size()
             << ", " << finder.max_search_depth()
             << ", " << finder.restrict_even_best()
+            << ", " << finder.reversed_best()
             << std::endl;
-        tour.forward_swap(finder.best(), finder.restrict_even_best());
-        if (constants::write_best)
+        const forward::StatsTimer forward_swap_timer;
+        tour.forward_swap(finder.best(), finder.restrict_even_best(), finder.reversed_best());
+        write_stats(forward_swap_timer.seconds());
+        ++iteration;
+        finder.activate_neighborhood(tour.changed());
+        or_optimizer.activate(tour.changed());
+        if (checkpointer)
         {
-            fileio::write_ordered_points(tour.order()
-                , "./saves/test_" + std::to_string(tour.size()) + "_" + std::to_string(tour.length()) + ".txt");
+            checkpointer->offer(tour);
         }
     }
+
+    // Iterated local search; with multiple starts, kicks are applied to each start instead.
+    if (search and starts <= 1 and (kicks > 0 or kick_seconds > 0))
+    {
+        perturbation::DoubleBridge kicker(tree, tour, options.get_size("seed", 0));
+        kicker.use_candidates(candidates.get());
+        finder.incremental(true, false);
+        const auto reoptimize = [&]()
+        {
+            while (true)
+            {
+                if (or_opt_mode != 0 and or_optimizer.optimize() > 0)
+                {
+                    finder.activate_neighborhood(or_optimizer.changed());
+                }
+                if (finder.find_best().empty())
+                {
+                    return;
+                }
+                tour.forward_swap(finder.best(), finder.restrict_even_best(), finder.reversed_best());
+                finder.activate_neighborhood(tour.changed());
+                or_optimizer.activate(tour.changed());
+            }
+        };
+        size_t accepted {0};
+        const auto kicked {kicker.iterate(kicks, kick_seconds, [&]()
+            {
+                finder.activate_neighborhood(tour.changed());
+                or_optimizer.activate(tour.changed());
+                reoptimize();
+            }
+            , [&](size_t kick)
+            {
+                ++accepted;
+                std::cout << "kick, length: " << kick << ", " << tour.length() << std::endl;
+                if (checkpointer)
+                {
+                    checkpointer->offer(tour);
+                }
+            })};
+        std::cout << "kicks, accepted: " << kicked << ", " << accepted << std::endl;
+    }
+
+    if (checkpointer)
+    {
+        checkpointer->flush(tour);
+    }
     std::cout << "final length: " << tour.length() << std::endl;
     tour.validate();
     return 0;
@@ -0,0 +1,295 @@
+#include "multistart.h"
+
+#include "ThreadPool.h"
+#include "Tour.h"
+#include "constants.h"
+#include "construction.h"
+#include "or_opt/Optimizer.h"
+#include "perturbation/DoubleBridge.h"
+
+#include <algorithm> // all_of, any_of, max
+#include <array>
+#include <numeric> // iota
+
+namespace multistart {
+
+namespace {
+
+using Adjacency = std::array<primitives::point_id_t, 2>; // previous, next.
+
+std::vector<Adjacency> adjacency(const std::vector<primitives::point_id_t>& tour)
+{
+    std::vector<Adjacency> neighbors(tour.size());
+    for (size_t i {0}; i < tour.size(); ++i)
+    {
+        const auto next {tour[i + 1 == tour.size() ? 0 : i + 1]};
+        neighbors[tour[i]][1] = next;
+        neighbors[next][0] = tour[i];
+    }
+    return neighbors;
+}
+
+bool adjacent(const std::vector<Adjacency>& neighbors, primitives::point_id_t a, primitives::point_id_t b)
+{
+    return neighbors[a][0] == b or neighbors[a][1] == b;
+}
+
+primitives::point_id_t find(std::vector<primitives::point_id_t>& parent, primitives::point_id_t i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+// If a and b are the same cycle, in any rotation or direction.
+bool same_cycle(const std::vector<primitives::point_id_t>& a, const std::vector<primitives::point_id_t>& b)
+{
+    const auto a_neighbors {adjacency(a)};
+    const auto b_neighbors {adjacency(b)};
+    for (primitives::point_id_t p {0}; p < a.size(); ++p)
+    {
+        if (not adjacent(b_neighbors, p, a_neighbors[p][0]) or not adjacent(b_neighbors, p, a_neighbors[p][1]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Applies forward swaps (and or-opt moves) until none improve.
+void descend(Tour& tour, forward::Finder& finder, or_opt::Optimizer& or_optimizer, size_t or_opt_mode)
+{
+    if (or_opt_mode == 1 and or_optimizer.optimize() > 0)
+    {
+        finder.activate_neighborhood(or_optimizer.changed());
+    }
+    while (true)
+    {
+        if (or_opt_mode == 2 and or_optimizer.optimize() > 0)
+        {
+            finder.activate_neighborhood(or_optimizer.changed());
+        }
+        if (finder.find_best().empty())
+        {
+            return;
+        }
+        tour.forward_swap(finder.best(), finder.restrict_even_best(), finder.reversed_best());
+        finder.activate_neighborhood(tour.changed());
+        or_optimizer.activate(tour.changed());
+    }
+}
+
+std::vector<primitives::point_id_t> optimize(const LengthMap& shared
+    , const point_quadtree::Tree& tree
+    , const std::vector<primitives::point_id_t>& initial_tour
+    , const Settings& settings
+    , size_t start
+    , bool perturb)
+{
+    LengthMap length_map(shared, shared.cache(), shared.cache_size());
+    Tour tour(initial_tour, &length_map);
+    forward::Finder finder(tree, tour);
+    finder.use_candidates(settings.candidates);
+    finder.strategy(settings.strategy);
+    finder.both_directions(settings.both_directions);
+    finder.incremental(settings.incremental);
+    or_opt::Optimizer or_optimizer(tree, tour);
+    or_optimizer.use_candidates(settings.candidates);
+    perturbation::DoubleBridge kicker(tree, tour, settings.seed + start);
+    kicker.use_candidates(settings.candidates);
+    // Repeated constructions are perturbed so that they reach different local optima.
+    if (perturb)
+    {
+        for (size_t kick {0}; kick <= tour.size() / constants::multistart_kick_points; ++kick)
+        {
+            kicker.kick();
+        }
+    }
+    descend(tour, finder, or_optimizer, settings.or_opt_mode);
+    if (settings.kicks > 0 or settings.kick_seconds > 0)
+    {
+        finder.incremental(true, false);
+        const auto or_opt_mode {settings.or_opt_mode == 0 ? 0 : 2};
+        kicker.iterate(settings.kicks, settings.kick_seconds, [&]()
+            {
+                finder.activate_neighborhood(tour.changed());
+                or_optimizer.activate(tour.changed());
+                descend(tour, finder, or_optimizer, or_opt_mode);
+            }
+            , [](size_t) {});
+    }
+    return tour.order();
+}
+
+} // namespace
+
+std::vector<std::vector<primitives::point_id_t>> run(const LengthMap& length_map
+    , const point_quadtree::Tree& tree
+    , const point_quadtree::Domain& domain
+    , const std::vector<primitives::point_id_t>& initial_tour
+    , const Settings& settings
+    , size_t threads)
+{
+    ThreadPool pool(std::max<size_t>(threads, 1));
+    // initial tour, greedy, nearest neighbor; constructions equal to an earlier one are dropped.
+    std::vector<std::vector<primitives::point_id_t>> constructions(3);
+    constructions[0] = initial_tour;
+    pool.run(2, [&](size_t, size_t c)
+    {
+        constructions[c + 1] = c == 0 ? construction::greedy(length_map.x(), length_map.y(), tree, domain) : construction::nearest_neighbor(tree);
+    });
+    for (size_t c {1}; c < constructions.size();)
+    {
+        const bool repeated {std::any_of(std::cbegin(constructions), std::cbegin(constructions) + c
+            , [&](const auto& earlier) { return same_cycle(earlier, constructions[c]); })};
+        if (repeated)
+        {
+            constructions.erase(std::begin(constructions) + c);
+        }
+        else
+        {
+            ++c;
+        }
+    }
+    std::vector<std::vector<primitives::point_id_t>> tours(settings.starts);
+    pool.run(settings.starts, [&](size_t, size_t start)
+    {
+        const auto& tour {constructions[start % constructions.size()]};
+        tours[start] = optimize(length_map, tree, tour, settings, start, start >= constructions.size());
+    });
+    return tours;
+}
+
+std::vector<primitives::point_id_t> merge(const std::vector<primitives::point_id_t>& a
+    , const std::vector<primitives::point_id_t>& b
+    , LengthMap& length_map)
+{
+    const auto n {a.size()};
+    if (n < 8)
+    {
+        return a;
+    }
+    const auto a_neighbors {adjacency(a)};
+    const auto b_neighbors {adjacency(b)};
+
+    // Regions: components of edges in only one tour.
+    std::vector<primitives::point_id_t> parent(n);
+    std::iota(std::begin(parent), std::end(parent), 0);
+    std::vector<bool> differs(n, false);
+    for (const auto* tour : {&a_neighbors, &b_neighbors})
+    {
+        const auto& other {tour == &a_neighbors ? b_neighbors : a_neighbors};
+        for (primitives::point_id_t p {0}; p < n; ++p)
+        {
+            const auto q {(*tour)[p][1]};
+            if (not adjacent(other, p, q))
+            {
+                differs[p] = true;
+                differs[q] = true;
+                parent[find(parent, p)] = find(parent, q);
+            }
+        }
+    }
+    // Per region root: edges to other points in a, sizes and path lengths in a and b.
+    std::vector<primitives::point_id_t> exits(n, 0);
+    std::vector<primitives::point_id_t> size(n, 0);
+    std::vector<primitives::length_t> a_length(n, 0);
+    std::vector<primitives::length_t> b_length(n, 0);
+    const auto region = [&](primitives::point_id_t p)
+    {
+        return differs[p] ? find(parent, p) : constants::invalid_point;
+    };
+    for (primitives::point_id_t p {0}; p < n; ++p)
+    {
+        const auto r {region(p)};
+        if (r == constants::invalid_point)
+        {
+            continue;
+        }
+        ++size[r];
+        const auto a_next {a_neighbors[p][1]};
+        const auto b_next {b_neighbors[p][1]};
+        for (auto q : a_neighbors[p])
+        {
+            exits[r] += region(q) != r;
+        }
+        if (region(a_next) == r)
+        {
+            a_length[r] += length_map.length(p, a_next);
+        }
+        if (region(b_next) == r)
+        {
+            b_length[r] += length_map.length(p, b_next);
+        }
+    }
+    // With 2 exits, a and b both visit the region in one path between the same points.
+    const auto replaced = [&](primitives::point_id_t r)
+    {
+        return r != constants::invalid_point and exits[r] == 2 and b_length[r] < a_length[r];
+    };
+
+    // Start outside replaced regions, so that no region wraps around the end of a.
+    size_t start {0};
+    while (start < n and replaced(region(a[start])))
+    {
+        ++start;
+    }
+    if (start == n)
+    {
+        return a;
+    }
+    std::vector<primitives::point_id_t> merged;
+    merged.reserve(n);
+    size_t i {start};
+    while (i < start + n)
+    {
+        const auto p {a[i % n]};
+        const auto r {region(p)};
+        if (not replaced(r))
+        {
+            merged.push_back(p);
+            ++i;
+            continue;
+        }
+        // p is where a enters the region; follow b from p to the other exit.
+        auto previous {a_neighbors[p][0]};
+        auto current {p};
+        for (primitives::point_id_t k {0}; k < size[r]; ++k)
+        {
+            merged.push_back(current);
+            const auto next {b_neighbors[current][b_neighbors[current][0] == previous ? 1 : 0]};
+            previous = current;
+            current = next;
+        }
+        i += size[r];
+    }
+    return merged;
+}
+
+std::vector<std::pair<primitives::point_id_t, primitives::point_id_t>> shared_edges(
+    const std::vector<primitives::point_id_t>& tour
+    , const std::vector<std::vector<primitives::point_id_t>>& tours)
+{
+    std::vector<std::vector<Adjacency>> neighbors;
+    for (const auto& other : tours)
+    {
+        neighbors.push_back(adjacency(other));
+    }
+    std::vector<std::pair<primitives::point_id_t, primitives::point_id_t>> edges;
+    for (size_t i {0}; i < tour.size(); ++i)
+    {
+        const auto p {tour[i]};
+        const auto q {tour[i + 1 == tour.size() ? 0 : i + 1]};
+        if (std::all_of(std::cbegin(neighbors), std::cend(neighbors)
+            , [p, q](const auto& other) { return adjacent(other, p, q); }))
+        {
+            edges.push_back({p, q});
+        }
+    }
+    return edges;
+}
+
+} // namespace multistart
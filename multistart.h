@@ -0,0 +1,60 @@
+#pragma once
+
+// Independent local searches from different initial tours, and tour merging.
+// run() optimizes several starts in parallel. Starts cycle through the given tour and
+//  the greedy and nearest-neighbor constructions, skipping constructions that are the
+//  same tour as an earlier one; after the first cycle, the initial tour is perturbed
+//  by random double bridges (one per constants::multistart_kick_points
+//  points). Start k uses seed + k for perturbation and kicks. Coordinates (including the
+//  LengthMap's narrow copies), quadtree and candidates are shared read-only; each start
+//  has its own LengthMap cache, Tour and Finder.
+// Space-filling curve tours are not used, as forward swap search from them is slow.
+// merge() keeps the tour paths of a, except in regions where a and b differ and
+//  b visits the region in one path between the same two points: there the
+//  shorter path is used. Regions are connected components of the edges that
+//  are in only one of the two tours.
+
+#include "CandidateSet.h"
+#include "LengthMap.h"
+#include "forward/Finder.h"
+#include "point_quadtree/Domain.h"
+#include "point_quadtree/Tree.h"
+#include "primitives.h"
+
+#include <utility> // pair
+#include <vector>
+
+namespace multistart {
+
+struct Settings
+{
+    size_t starts {1};
+    const CandidateSet* candidates {nullptr};
+    forward::Finder::Strategy strategy {forward::Finder::Strategy::best};
+    bool incremental {false};
+    bool both_directions {true};
+    size_t or_opt_mode {0}; // off, pre, interleaved.
+    size_t kicks {0};
+    size_t kick_seconds {0};
+    uint64_t seed {0};
+};
+
+// Returns the local optimum of each start.
+// Each start's LengthMap shares the coordinates of length_map and has the same kind of cache.
+std::vector<std::vector<primitives::point_id_t>> run(const LengthMap& length_map
+    , const point_quadtree::Tree&
+    , const point_quadtree::Domain&
+    , const std::vector<primitives::point_id_t>& initial_tour
+    , const Settings&
+    , size_t threads);
+
+std::vector<primitives::point_id_t> merge(const std::vector<primitives::point_id_t>& a
+    , const std::vector<primitives::point_id_t>& b
+    , LengthMap&);
+
+// Edges of tour that are also in every one of tours.
+std::vector<std::pair<primitives::point_id_t, primitives::point_id_t>> shared_edges(
+    const std::vector<primitives::point_id_t>& tour
+    , const std::vector<std::vector<primitives::point_id_t>>& tours);
+
+} // namespace multistart
@@ -0,0 +1,124 @@
+#pragma once
+
+// Command line options.
+// Arguments of the form "--name=value" are named options, and "--name" is a flag
+//  (a named option with an empty value); all others are positional.
+// Programs list the names they accept with check_names, so that misspelled options are reported.
+
+#include <cstdlib> // abort, exit, strtoull
+#include <algorithm> // none_of
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace options {
+
+class Options
+{
+public:
+    Options(int argc, const char** argv)
+    {
+        for (int i {1}; i < argc; ++i)
+        {
+            const std::string argument(argv[i]);
+            if (argument.rfind("--", 0) != 0)
+            {
+                m_positional.push_back(argument);
+                continue;
+            }
+            const auto equals {argument.find('=')};
+            if (equals == std::string::npos)
+            {
+                m_named[argument.substr(2)] = ""; // flag.
+                continue;
+            }
+            m_named[argument.substr(2, equals - 2)] = argument.substr(equals + 1);
+        }
+    }
+
+    const std::vector<std::string>& positional() const { return m_positional; }
+    const char* positional(size_t i) const
+    {
+        return i < m_positional.size() ? m_positional[i].c_str() : nullptr;
+    }
+
+    // Exits if a named option is not one of names.
+    void check_names(std::initializer_list<const char*> names) const
+    {
+        bool unknown {false};
+        for (const auto& named : m_named)
+        {
+            if (std::none_of(std::cbegin(names), std::cend(names)
+                , [&named](const char* name) { return named.first == name; }))
+            {
+                std::cout << __func__ << ": error: unknown option: --" << named.first << std::endl;
+                unknown = true;
+            }
+        }
+        if (unknown)
+        {
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    bool has(const std::string& name) const { return m_named.find(name) != std::cend(m_named); }
+
+    std::string get(const std::string& name, const std::string& default_value) const
+    {
+        const auto it {m_named.find(name)};
+        return it == std::cend(m_named) ? default_value : it->second;
+    }
+
+    size_t get_size(const std::string& name, size_t default_value) const
+    {
+        const auto it {m_named.find(name)};
+        if (it == std::cend(m_named))
+        {
+            return default_value;
+        }
+        char* end {nullptr};
+        const auto value {std::strtoull(it->second.c_str(), &end, 10)};
+        if (it->second.empty() or *end != '\0')
+        {
+            std::cout << __func__ << ": error: --" << name << " expects an integer, got: " << it->second << std::endl;
+            std::abort();
+        }
+        return value;
+    }
+
+    // Returns the index of the value of option "name" in choices.
+    size_t get_choice(const std::string& name
+        , std::initializer_list<const char*> choices
+        , size_t default_index) const
+    {
+        const auto it {m_named.find(name)};
+        if (it == std::cend(m_named))
+        {
+            return default_index;
+        }
+        size_t index {0};
+        for (auto choice : choices)
+        {
+            if (it->second == choice)
+            {
+                return index;
+            }
+            ++index;
+        }
+        std::cout << __func__ << ": error: invalid value for --" << name << ": " << it->second << " (choices:";
+        for (auto choice : choices)
+        {
+            std::cout << " " << choice;
+        }
+        std::cout << ")" << std::endl;
+        std::abort();
+    }
+
+private:
+    std::vector<std::string> m_positional;
+    std::unordered_map<std::string, std::string> m_named;
+};
+
+} // namespace options
@@ -0,0 +1,216 @@
+#include "Optimizer.h"
+
+#include <algorithm> // max
+#include <cstdlib> // abort
+#include <iostream>
+#include <utility> // pair
+
+namespace or_opt {
+
+size_t Optimizer::optimize()
+{
+    m_changed.clear();
+    if (m_active.empty())
+    {
+        m_active.assign(m_tour.size(), false);
+        constexpr primitives::point_id_t start {0};
+        primitives::point_id_t i {start};
+        do
+        {
+            activate(i);
+            i = m_tour.next(i);
+        } while (i != start);
+    }
+
+    size_t moves {0};
+    while (not m_active_queue.empty())
+    {
+        const auto first {m_active_queue.front()};
+        m_active_queue.pop_front();
+        m_active[first] = false;
+        const auto move {find_best(first)};
+        if (move.gain == 0)
+        {
+            continue;
+        }
+        apply(move);
+        ++moves;
+        for (auto p : m_tour.changed())
+        {
+            m_changed.push_back(p);
+            activate(p);
+        }
+    }
+    return moves;
+}
+
+void Optimizer::fix_edge(primitives::point_id_t a, primitives::point_id_t b)
+{
+    if (m_fixed.empty())
+    {
+        m_fixed.assign(m_tour.size(), {constants::invalid_point, constants::invalid_point});
+    }
+    for (auto [p, q] : {std::pair{a, b}, std::pair{b, a}})
+    {
+        auto& partners {m_fixed[p]};
+        if (partners[0] != constants::invalid_point and partners[1] != constants::invalid_point)
+        {
+            std::cout << __func__ << ": error: more than 2 fixed edges at point " << p << std::endl;
+            std::abort();
+        }
+        partners[partners[0] == constants::invalid_point ? 0 : 1] = q;
+    }
+}
+
+void Optimizer::activate_only(const std::vector<primitives::point_id_t>& points)
+{
+    m_active.assign(m_tour.size(), false);
+    m_active_queue.clear();
+    for (auto p : points)
+    {
+        activate(p);
+    }
+}
+
+void Optimizer::activate(const std::vector<primitives::point_id_t>& points)
+{
+    if (m_active.empty())
+    {
+        return; // everything is searched by the first optimize().
+    }
+    for (auto p : points)
+    {
+        activate(p);
+    }
+}
+
+void Optimizer::activate(primitives::point_id_t i)
+{
+    if (not m_active[i])
+    {
+        m_active[i] = true;
+        m_active_queue.push_back(i);
+    }
+}
+
+void Optimizer::get_points(primitives::point_id_t i
+    , primitives::length_t radius
+    , std::vector<primitives::point_id_t>& points) const
+{
+    const auto search_circle {m_tour.search_circle(i, radius)};
+    if (m_candidates)
+    {
+        for (auto p : m_candidates->neighbors(i))
+        {
+            if (not search_circle.contains(m_tour.x(p), m_tour.y(p)))
+            {
+                break; // candidates are sorted by distance.
+            }
+            points.push_back(p);
+        }
+        return;
+    }
+    m_tree.get_points(i, search_circle, points);
+}
+
+Optimizer::Move Optimizer::find_best(primitives::point_id_t first)
+{
+    Move best;
+    const auto before {m_tour.prev(first)};
+    if (fixed(before, first))
+    {
+        return best;
+    }
+    auto last {first};
+    for (primitives::point_id_t size {1}; size <= constants::or_opt_max_segment; ++size)
+    {
+        if (size > 1)
+        {
+            last = m_tour.next(last);
+        }
+        const auto after {m_tour.next(last)};
+        // the path must leave at least 2 other points to insert between.
+        if (after == before or m_tour.next(after) == before)
+        {
+            break;
+        }
+        if (fixed(last, after))
+        {
+            continue;
+        }
+        const auto removed {m_tour.length(before, first) + m_tour.length(last, after)};
+        const auto closing {m_tour.length(before, after)};
+        if (removed <= closing)
+        {
+            continue;
+        }
+        const auto removal_gain {removed - closing};
+        for (auto end : {first, last})
+        {
+            m_points.clear();
+            get_points(end, removal_gain, m_points);
+            for (auto p : m_points)
+            {
+                // the new edge at end can be on either side of p.
+                check_insertion(first, last, p, removal_gain, best);
+                check_insertion(first, last, m_tour.prev(p), removal_gain, best);
+            }
+        }
+    }
+    return best;
+}
+
+void Optimizer::check_insertion(primitives::point_id_t first
+    , primitives::point_id_t last
+    , primitives::point_id_t a
+    , primitives::length_t removal_gain
+    , Move& best)
+{
+    // a and next(a) must both be outside of the path; a == prev(first) leaves the tour unchanged.
+    const auto b {m_tour.next(a)};
+    if (fixed(a, b))
+    {
+        return;
+    }
+    for (auto p {first}; ; p = m_tour.next(p))
+    {
+        if (p == a or p == b)
+        {
+            return;
+        }
+        if (p == last)
+        {
+            break;
+        }
+    }
+    const auto forward {m_tour.length(a, first) + m_tour.length(last, b)};
+    const auto reverse {m_tour.length(a, last) + m_tour.length(first, b)};
+    const bool use_reverse {reverse < forward};
+    const auto added {use_reverse ? reverse : forward};
+    const auto removed {removal_gain + m_tour.length(a, b)};
+    if (removed <= added)
+    {
+        return;
+    }
+    const auto gain {removed - added};
+    if (gain > best.gain)
+    {
+        best.first = first;
+        best.last = last;
+        best.a = a;
+        best.reverse = use_reverse;
+        best.gain = gain;
+    }
+}
+
+void Optimizer::apply(const Move& move)
+{
+    if (move.first == move.last)
+    {
+        m_tour.vmove(move.first, move.a);
+        return;
+    }
+    m_tour.segment_move(move.first, move.last, move.a, move.reverse);
+}
+
+} // namespace or_opt
@@ -0,0 +1,87 @@
+#pragma once
+
+// Or-opt: moves a path of 1 to constants::or_opt_max_segment consecutive points
+//  between two other adjacent points, in either orientation.
+// Insertion positions are the tour edges at points within the removal gain
+//  of either end of the path (quadtree radius query, or CandidateSet if given).
+// Each start point tries every path length and applies the best improving move
+//  through Tour::vmove (single points) or Tour::segment_move.
+// optimize() runs until no start point improves, like Finder's incremental mode:
+//  the first call searches every point, later ones only points at changed edges.
+// It can be used as a pre-pass before forward swaps or called between them.
+// Fixed edges (see fix_edge) are never removed, like in forward::Finder.
+
+#include <CandidateSet.h>
+#include <point_quadtree/Tree.h>
+#include <Tour.h>
+#include <constants.h>
+#include <primitives.h>
+
+#include <array>
+#include <deque>
+#include <vector>
+
+namespace or_opt {
+
+class Optimizer
+{
+public:
+    Optimizer(const point_quadtree::Tree& tree, Tour& tour) : m_tree(tree), m_tour(tour) {}
+
+    // candidates can be null to return to quadtree queries.
+    void use_candidates(const CandidateSet* candidates) { m_candidates = candidates; }
+
+    // Edge (a, b) will not be removed by any move. A point can have up to 2 fixed edges.
+    void fix_edge(primitives::point_id_t a, primitives::point_id_t b);
+    // The first optimize() searches only points instead of every point.
+    void activate_only(const std::vector<primitives::point_id_t>& points);
+
+    // Applies improving moves until none are found; returns the number of moves.
+    size_t optimize();
+    // Call after other tour modifications with the endpoints of changed edges.
+    void activate(const std::vector<primitives::point_id_t>& points);
+    // Endpoints of edges changed by the last optimize().
+    const std::vector<primitives::point_id_t>& changed() const { return m_changed; }
+
+private:
+    struct Move
+    {
+        primitives::point_id_t first {constants::invalid_point};
+        primitives::point_id_t last {constants::invalid_point};
+        primitives::point_id_t a {constants::invalid_point}; // insert between a and next(a).
+        bool reverse {false};
+        primitives::length_t gain {0};
+    };
+
+    const point_quadtree::Tree& m_tree;
+    Tour& m_tour;
+    const CandidateSet* m_candidates {nullptr};
+    // Fixed edge partners of each point (invalid_point if none); empty if no edges are fixed.
+    std::vector<std::array<primitives::point_id_t, 2>> m_fixed;
+
+    std::vector<bool> m_active;
+    std::deque<primitives::point_id_t> m_active_queue;
+    std::vector<primitives::point_id_t> m_changed;
+    std::vector<primitives::point_id_t> m_points;
+
+    void activate(primitives::point_id_t i);
+    bool fixed(primitives::point_id_t a, primitives::point_id_t b) const
+    {
+        return not m_fixed.empty() and (m_fixed[a][0] == b or m_fixed[a][1] == b);
+    }
+    // Appends points within radius of i.
+    void get_points(primitives::point_id_t i
+        , primitives::length_t radius
+        , std::vector<primitives::point_id_t>& points) const;
+    // Best improving move of a path starting at first; gain is 0 if none.
+    Move find_best(primitives::point_id_t first);
+    // Tries inserting first..last between a and next(a).
+    void check_insertion(primitives::point_id_t first
+        , primitives::point_id_t last
+        , primitives::point_id_t a
+        , primitives::length_t removal_gain
+        , Move& best);
+    void apply(const Move& move);
+};
+
+} // namespace or_opt
@@ -0,0 +1,165 @@
+#include "Solver.h"
+
+#include <CandidateSet.h>
+#include <LengthMap.h>
+#include <ThreadPool.h>
+#include <Tour.h>
+#include <point_quadtree/Tree.h>
+#include <point_quadtree/morton_keys.h>
+
+#include <algorithm> // max
+#include <cmath> // floor
+#include <numeric> // accumulate, iota
+#include <utility> // pair
+
+namespace partition {
+
+namespace {
+
+// Smaller paths have no improving move that keeps both endpoints.
+constexpr size_t min_path_size {4};
+
+} // namespace
+
+Solver::Solver(const std::vector<primitives::space_t>& x
+    , const std::vector<primitives::space_t>& y
+    , const point_quadtree::Domain& domain
+    , const Settings& settings
+    , size_t threads)
+    : m_x(x), m_y(y), m_domain(domain), m_settings(settings)
+    , m_pool(std::make_unique<ThreadPool>(std::max<size_t>(threads, 1)))
+{
+    size_t capacity {std::max<size_t>(m_settings.tile_points, 1)};
+    while (capacity < m_x.size() and m_level < constants::max_tree_depth - 1)
+    {
+        capacity *= 4;
+        ++m_level;
+    }
+}
+
+Solver::~Solver() = default;
+
+primitives::length_t Solver::round(std::vector<primitives::point_id_t>& tour, bool offset)
+{
+    find_paths(tour, offset);
+    std::vector<primitives::length_t> improvements(m_paths.size(), 0);
+    m_pool->run(m_paths.size(), [this, &tour, &improvements, offset](size_t, size_t k)
+    {
+        improvements[k] = optimize(tour, m_paths[k], offset);
+    });
+    return std::accumulate(std::cbegin(improvements), std::cend(improvements), primitives::length_t {0});
+}
+
+void Solver::find_paths(const std::vector<primitives::point_id_t>& tour, bool offset)
+{
+    m_paths.clear();
+    const primitives::space_t shift {offset ? 0.5 : 0.0};
+    const auto tile = [this, &tour, shift](size_t position)
+    {
+        const auto p {tour[position % tour.size()]};
+        return std::pair<primitives::grid_t, primitives::grid_t>(
+            std::floor((m_x[p] - m_domain.xmin()) / m_domain.xdim(m_level) + shift)
+            , std::floor((m_y[p] - m_domain.ymin()) / m_domain.ydim(m_level) + shift));
+    };
+    // Paths cannot wrap around the end of tour, so start at the first tile change.
+    const auto n {tour.size()};
+    size_t start {0};
+    while (start < n and tile(start) == tile(start + n - 1))
+    {
+        ++start;
+    }
+    m_cycle = start == n;
+    if (m_cycle)
+    {
+        const auto [column, row] {tile(0)};
+        m_paths.push_back({0, n, column, row});
+        return;
+    }
+    Path path {start, 0, tile(start).first, tile(start).second};
+    for (size_t position {start}; position < start + n; ++position)
+    {
+        const auto [column, row] {tile(position)};
+        if (column != path.column or row != path.row)
+        {
+            if (path.size >= min_path_size)
+            {
+                m_paths.push_back(path);
+            }
+            path = {position % n, 0, column, row};
+        }
+        ++path.size;
+    }
+    if (path.size >= min_path_size)
+    {
+        m_paths.push_back(path);
+    }
+}
+
+primitives::length_t Solver::optimize(std::vector<primitives::point_id_t>& tour, const Path& path, bool offset) const
+{
+    const auto n {tour.size()};
+    std::vector<primitives::point_id_t> ids(path.size);
+    std::vector<primitives::space_t> x(path.size);
+    std::vector<primitives::space_t> y(path.size);
+    for (size_t k {0}; k < path.size; ++k)
+    {
+        ids[k] = tour[(path.begin + k) % n];
+        x[k] = m_x[ids[k]];
+        y[k] = m_y[ids[k]];
+    }
+    // The tile box is the domain, so paths along a line do not have an empty domain.
+    const primitives::space_t shift {offset ? 0.5 : 0.0};
+    const auto xmin {m_domain.xmin() + (path.column - shift) * m_domain.xdim(m_level)};
+    const auto ymin {m_domain.ymin() + (path.row - shift) * m_domain.ydim(m_level)};
+    const point_quadtree::Domain domain(m_cycle ? x : std::vector<primitives::space_t>{xmin, xmin + m_domain.xdim(m_level)}
+        , m_cycle ? y : std::vector<primitives::space_t>{ymin, ymin + m_domain.ydim(m_level)});
+    const auto morton_keys {point_quadtree::morton_keys::compute_point_morton_keys(x, y, domain)};
+    const point_quadtree::Tree tree(x, y, morton_keys, domain);
+
+    // A flat table of the default size would dwarf a tile, so its default scales with the path.
+    const auto cache_size {m_settings.length_cache == LengthMap::Cache::flat and m_settings.length_cache_size == 0
+        ? path.size * constants::neighbor_length_slots : m_settings.length_cache_size};
+    LengthMap length_map(x, y, m_settings.length_cache, cache_size, m_settings.storage);
+    std::vector<primitives::point_id_t> initial_tour(path.size);
+    std::iota(std::begin(initial_tour), std::end(initial_tour), 0);
+    Tour local(initial_tour, &length_map);
+    const auto initial_length {local.length()};
+
+    forward::Finder finder(tree, local);
+    std::unique_ptr<CandidateSet> candidates;
+    if (m_settings.candidates > 0)
+    {
+        candidates = std::make_unique<CandidateSet>(x, y, tree, domain, m_settings.candidates, 0);
+        candidates->compute_lengths(length_map);
+        finder.use_candidates(candidates.get());
+    }
+    finder.strategy(m_settings.strategy);
+    finder.both_directions(m_settings.both_directions);
+    const primitives::point_id_t last {static_cast<primitives::point_id_t>(path.size - 1)};
+    if (not m_cycle)
+    {
+        finder.fix_edge(last, 0);
+    }
+    finder.incremental(m_settings.incremental);
+    while (not finder.find_best().empty())
+    {
+        local.forward_swap(finder.best(), finder.restrict_even_best(), finder.reversed_best());
+        finder.activate_neighborhood(local.changed());
+    }
+    if (local.length() == initial_length)
+    {
+        return 0;
+    }
+
+    // Write back from the first to the last point, away from the fixed edge.
+    const bool forward {m_cycle or local.next(0) != last};
+    primitives::point_id_t p {0};
+    for (size_t k {0}; k < path.size; ++k)
+    {
+        tour[(path.begin + k) % n] = ids[p];
+        p = forward ? local.next(p) : local.prev(p);
+    }
+    return initial_length - local.length();
+}
+
+} // namespace partition
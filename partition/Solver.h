@@ -0,0 +1,78 @@
+#pragma once
+
+// Partitioned solve for instances too large for whole-tour sweeps.
+// The plane is split into a grid of square tiles at a quadtree level, chosen so
+//  that tiles hold about settings.tile_points points on average.
+// Each maximal tour path inside a tile is optimized on its own, as a small tour
+//  closed by a fixed edge between the path endpoints (see forward::Finder::fix_edge).
+// The endpoints and the set of points of every path stay the same, so paths can be
+//  optimized in parallel and written back to the same tour positions.
+// Odd rounds shift the tile grid by half a tile in x and y, so that edges crossing
+//  tile boundaries in one round are inside a tile in the next.
+// Each path only allocates its own tree, tour and length map, which bounds the
+//  memory used by each worker by the tile size.
+
+#include <forward/Finder.h>
+#include <LengthMap.h>
+#include <point_quadtree/Domain.h>
+#include <constants.h>
+#include <primitives.h>
+
+#include <memory> // unique_ptr
+#include <vector>
+
+class ThreadPool;
+
+namespace partition {
+
+struct Settings
+{
+    size_t tile_points {constants::partition_tile_points};
+    size_t candidates {0}; // nearest neighbors per point, or 0 for quadtree queries.
+    LengthMap::Cache length_cache {LengthMap::Cache::none};
+    size_t length_cache_size {0}; // 0: LengthMap default; for flat caches, scaled to the path.
+    LengthMap::Storage storage {LengthMap::Storage::double_precision};
+    forward::Finder::Strategy strategy {forward::Finder::Strategy::best};
+    bool incremental {false};
+    bool both_directions {true};
+};
+
+class Solver
+{
+public:
+    Solver(const std::vector<primitives::space_t>& x
+        , const std::vector<primitives::space_t>& y
+        , const point_quadtree::Domain&
+        , const Settings&
+        , size_t threads);
+    ~Solver();
+
+    // Optimizes every tile path of tour in place; returns the total length improvement.
+    primitives::length_t round(std::vector<primitives::point_id_t>& tour, bool offset);
+    // Number of paths optimized by the last round.
+    size_t path_count() const { return m_paths.size(); }
+
+private:
+    struct Path
+    {
+        size_t begin {0}; // tour position of the first point.
+        size_t size {0};
+        primitives::grid_t column {0}; // tile.
+        primitives::grid_t row {0};
+    };
+
+    const std::vector<primitives::space_t>& m_x;
+    const std::vector<primitives::space_t>& m_y;
+    const point_quadtree::Domain& m_domain;
+    const Settings m_settings;
+    primitives::depth_t m_level {0}; // quadtree level of the tiles.
+    std::unique_ptr<ThreadPool> m_pool;
+    std::vector<Path> m_paths;
+    bool m_cycle {false}; // if the whole tour is in one tile (no fixed edge).
+
+    void find_paths(const std::vector<primitives::point_id_t>& tour, bool offset);
+    // Optimizes the path and writes it back to its tour positions; returns the length improvement.
+    primitives::length_t optimize(std::vector<primitives::point_id_t>& tour, const Path&, bool offset) const;
+};
+
+} // namespace partition
@@ -0,0 +1,61 @@
+#include "DoubleBridge.h"
+
+#include <constants.h>
+
+#include <algorithm> // max, remove, sort
+#include <array>
+#include <utility> // swap
+
+namespace perturbation {
+
+bool DoubleBridge::kick()
+{
+    if (m_tour.size() < 8)
+    {
+        return false;
+    }
+    const auto a {std::uniform_int_distribution<primitives::point_id_t>(0, m_tour.size() - 1)(m_random)};
+    get_points(a);
+    if (m_points.size() < 3)
+    {
+        return false;
+    }
+    // Partial Fisher-Yates shuffle: 3 distinct points (m_points excludes a and has no duplicates).
+    std::array<primitives::point_id_t, 4> tails {a};
+    for (size_t k {0}; k < 3; ++k)
+    {
+        const auto j {std::uniform_int_distribution<size_t>(k, m_points.size() - 1)(m_random)};
+        std::swap(m_points[k], m_points[j]);
+        tails[k + 1] = m_points[k];
+    }
+    std::sort(std::begin(tails), std::end(tails), [this, a](auto p, auto q)
+    {
+        return m_tour.sequence(p, a) < m_tour.sequence(q, a);
+    });
+    m_tour.double_bridge(tails[0], tails[1], tails[2], tails[3]);
+    return true;
+}
+
+void DoubleBridge::get_points(primitives::point_id_t i)
+{
+    m_points.clear();
+    if (m_candidates)
+    {
+        for (auto p : m_candidates->neighbors(i))
+        {
+            m_points.push_back(p);
+        }
+        return;
+    }
+    // Doubles the radius from the longer adjacent edge until enough points are found.
+    auto radius {std::max<primitives::length_t>({m_tour.length(i), m_tour.prev_length(i), 1})};
+    for (int attempt {0}; attempt < 32 and m_points.size() <= constants::kick_neighbors; ++attempt)
+    {
+        m_points.clear();
+        m_tree.get_points(i, m_tour.search_circle(i, radius), m_points);
+        radius *= 2;
+    }
+    m_points.erase(std::remove(std::begin(m_points), std::end(m_points), i), std::end(m_points));
+}
+
+} // namespace perturbation
@@ -0,0 +1,81 @@
+#pragma once
+
+// Random double-bridge kicks for iterated local search.
+// A kick picks a random point and 3 points near it (from the CandidateSet if given,
+//  otherwise a growing quadtree radius query), sorts them in tour order and applies
+//  Tour::double_bridge to the edges after them. All 4 changed edges are near the
+//  first point, so re-optimizing the neighborhoods of Tour::changed() is enough
+//  to reach a new local optimum.
+
+#include <CandidateSet.h>
+#include <point_quadtree/Tree.h>
+#include <Tour.h>
+#include <primitives.h>
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace perturbation {
+
+class DoubleBridge
+{
+public:
+    DoubleBridge(const point_quadtree::Tree& tree, Tour& tour, uint64_t seed)
+        : m_tree(tree), m_tour(tour), m_random(seed) {}
+
+    // candidates can be null to return to quadtree queries.
+    void use_candidates(const CandidateSet* candidates) { m_candidates = candidates; }
+
+    // Returns false if no kick was applied (fewer than 3 points near the chosen point).
+    bool kick();
+
+    // Iterated local search: kicks until kicks (0: no limit) have been tried or seconds
+    //  (0: no limit) have passed. After each kick, reoptimize() must return the tour to a
+    //  local optimum, e.g. by searching around Tour::changed(). Kicks that do not shorten
+    //  the tour are rolled back; accepted(kick) is called after each one that does.
+    // Returns the number of kicks tried.
+    template <typename Reoptimize, typename Accepted>
+    size_t iterate(size_t kicks, size_t seconds, const Reoptimize& reoptimize, const Accepted& accepted)
+    {
+        const auto start {std::chrono::steady_clock::now()};
+        const auto out_of_time = [&]()
+        {
+            return seconds > 0 and std::chrono::steady_clock::now() - start >= std::chrono::seconds(seconds);
+        };
+        size_t kick {0};
+        for (; (kicks == 0 or kick < kicks) and not out_of_time(); ++kick)
+        {
+            const auto length {m_tour.length()};
+            m_tour.journal(true);
+            if (not this->kick())
+            {
+                continue;
+            }
+            reoptimize();
+            if (m_tour.length() < length)
+            {
+                accepted(kick);
+            }
+            else
+            {
+                m_tour.rollback();
+            }
+        }
+        m_tour.journal(false);
+        return kick;
+    }
+
+private:
+    const point_quadtree::Tree& m_tree;
+    Tour& m_tour;
+    const CandidateSet* m_candidates {nullptr};
+    std::mt19937_64 m_random;
+    std::vector<primitives::point_id_t> m_points;
+
+    // Fills m_points with at least constants::kick_neighbors points near i, if there are that many.
+    void get_points(primitives::point_id_t i);
+};
+
+} // namespace perturbation
@@ -18,5 +18,11 @@ struct Box
         bool outside {too_high or too_low or left or right};
         return not outside;
     }
+
+    bool contains(const Box& other) const
+    {
+        return xmin <= other.xmin and other.xmax <= xmax
+            and ymin <= other.ymin and other.ymax <= ymax;
+    }
 };
 
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Box.h"
+#include "primitives.h"
+
+#include <algorithm> // max
+
+struct Circle
+{
+    primitives::space_t x {0};
+    primitives::space_t y {0};
+    primitives::space_t radius {0};
+
+    bool contains(primitives::space_t px, primitives::space_t py) const
+    {
+        const auto dx {px - x};
+        const auto dy {py - y};
+        return dx * dx + dy * dy <= radius * radius;
+    }
+
+    bool touches(const Box& box) const
+    {
+        // distance from center to the nearest point of the box.
+        const auto dx {std::max({box.xmin - x, x - box.xmax, primitives::space_t{0}})};
+        const auto dy {std::max({box.ymin - y, y - box.ymax, primitives::space_t{0}})};
+        return dx * dx + dy * dy <= radius * radius;
+    }
+
+    bool contains(const Box& box) const
+    {
+        // distance from center to the farthest corner of the box.
+        const auto dx {std::max(x - box.xmin, box.xmax - x)};
+        const auto dy {std::max(y - box.ymin, box.ymax - y)};
+        return dx * dx + dy * dy <= radius * radius;
+    }
+};
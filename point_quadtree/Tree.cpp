@@ -0,0 +1,304 @@
+#include "Tree.h"
+
+#include "transform.h"
+#include <constants.h>
+
+#include <algorithm> // max, min, partition_point, sort, stable_sort
+#include <array>
+#include <limits>
+#include <numeric> // iota
+#include <utility> // pair
+
+namespace point_quadtree {
+
+namespace {
+
+primitives::space_t distance_squared(const Box& box, primitives::space_t x, primitives::space_t y)
+{
+    const auto dx {std::max({box.xmin - x, x - box.xmax, primitives::space_t{0}})};
+    const auto dy {std::max({box.ymin - y, y - box.ymax, primitives::space_t{0}})};
+    return dx * dx + dy * dy;
+}
+
+} // namespace
+
+Tree::Tree(const std::vector<primitives::space_t>& x
+    , const std::vector<primitives::space_t>& y
+    , const std::vector<primitives::morton_key_t>& morton_keys
+    , const Domain& domain)
+    : m_points(morton_keys.size())
+{
+    std::iota(std::begin(m_points), std::end(m_points), 0);
+    std::stable_sort(std::begin(m_points), std::end(m_points)
+        , [&morton_keys](auto a, auto b) { return morton_keys[a] < morton_keys[b]; });
+    std::vector<primitives::morton_key_t> sorted_keys;
+    sorted_keys.reserve(m_points.size());
+    m_x.reserve(m_points.size());
+    m_y.reserve(m_points.size());
+    for (auto p : m_points)
+    {
+        sorted_keys.push_back(morton_keys[p]);
+        m_x.push_back(x[p]);
+        m_y.push_back(y[p]);
+    }
+
+    Node root;
+    root.box.xmin = domain.xmin();
+    root.box.ymin = domain.ymin();
+    root.box.xmax = domain.xmin() + domain.xdim(0);
+    root.box.ymax = domain.ymin() + domain.ydim(0);
+    root.end = m_points.size();
+    m_nodes.push_back(root);
+    std::vector<primitives::depth_t> depths {0};
+
+    // Breadth-first subdivision; children are appended contiguously.
+    for (size_t n {0}; n < m_nodes.size(); ++n)
+    {
+        const auto depth {depths[n]};
+        const auto begin {m_nodes[n].begin};
+        const auto end {m_nodes[n].end};
+        // Nodes that would overflow node_id_t stay leaves; queries still filter leaf points exactly.
+        if (end - begin <= constants::quadtree_leaf_size or depth + 1 >= constants::max_tree_depth
+            or m_nodes.size() + 4 > std::numeric_limits<node_id_t>::max())
+        {
+            continue;
+        }
+        const auto child_depth {depth + 1};
+        const auto shift {2 * (constants::max_tree_depth - child_depth - 1)};
+        const auto parent_box {m_nodes[n].box};
+        m_nodes[n].first_child = m_nodes.size();
+        auto child_begin {begin};
+        for (primitives::quadrant_t q {0}; q < 4; ++q)
+        {
+            const auto quadrant_end = std::partition_point(std::cbegin(sorted_keys) + child_begin
+                , std::cbegin(sorted_keys) + end
+                , [shift, q](auto key)
+                {
+                    constexpr primitives::morton_key_t quadrant_mask {static_cast<primitives::morton_key_t>(3)}; // binary: 11
+                    return static_cast<primitives::quadrant_t>((key >> shift) & quadrant_mask) <= q;
+                });
+            const auto child_end {static_cast<primitives::point_id_t>(quadrant_end - std::cbegin(sorted_keys))};
+            if (child_end == child_begin)
+            {
+                continue;
+            }
+            Node child;
+            child.box.xmin = parent_box.xmin + transform::quadrant_x(q) * domain.xdim(child_depth);
+            child.box.ymin = parent_box.ymin + transform::quadrant_y(q) * domain.ydim(child_depth);
+            child.box.xmax = child.box.xmin + domain.xdim(child_depth);
+            child.box.ymax = child.box.ymin + domain.ydim(child_depth);
+            child.begin = child_begin;
+            child.end = child_end;
+            m_nodes.push_back(child);
+            depths.push_back(child_depth);
+            ++m_nodes[n].child_count;
+            child_begin = child_end;
+        }
+    }
+}
+
+void Tree::get_points(primitives::point_id_t
+    , const Box& search_box
+    , std::vector<primitives::point_id_t>& points) const
+{
+    if (m_nodes.empty() or not m_nodes.front().box.touches(search_box))
+    {
+        return;
+    }
+    // Depth-first traversal; children are pushed in reverse to output points in Morton order.
+    std::array<node_id_t, 4 * constants::max_tree_depth> stack;
+    size_t stack_size {0};
+    stack[stack_size++] = 0;
+    while (stack_size > 0)
+    {
+        const auto& node {m_nodes[stack[--stack_size]]};
+        if (node.child_count == 0 or search_box.contains(node.box))
+        {
+            points.insert(std::end(points)
+                , std::cbegin(m_points) + node.begin
+                , std::cbegin(m_points) + node.end);
+            continue;
+        }
+        for (auto c {node.first_child + node.child_count}; c-- > node.first_child;)
+        {
+            if (m_nodes[c].box.touches(search_box))
+            {
+                stack[stack_size++] = c;
+            }
+        }
+    }
+}
+
+size_t Tree::get_points(primitives::point_id_t
+    , const Circle& search_circle
+    , std::vector<primitives::point_id_t>& points) const
+{
+    if (m_nodes.empty() or not search_circle.touches(m_nodes.front().box))
+    {
+        return 0;
+    }
+    size_t visited {0};
+    std::array<node_id_t, 4 * constants::max_tree_depth> stack;
+    size_t stack_size {0};
+    stack[stack_size++] = 0;
+    while (stack_size > 0)
+    {
+        const auto& node {m_nodes[stack[--stack_size]]};
+        if constexpr (constants::search_stats)
+        {
+            ++visited;
+        }
+        if (search_circle.contains(node.box))
+        {
+            points.insert(std::end(points)
+                , std::cbegin(m_points) + node.begin
+                , std::cbegin(m_points) + node.end);
+            continue;
+        }
+        if (node.child_count == 0)
+        {
+            append_inside(search_circle, node, points);
+            continue;
+        }
+        for (auto c {node.first_child + node.child_count}; c-- > node.first_child;)
+        {
+            if (search_circle.touches(m_nodes[c].box))
+            {
+                stack[stack_size++] = c;
+            }
+        }
+    }
+    return visited;
+}
+
+Tree::Subset Tree::full_subset() const
+{
+    Subset subset;
+    subset.remaining.reserve(m_nodes.size());
+    for (const auto& node : m_nodes)
+    {
+        subset.remaining.push_back(node.end - node.begin);
+    }
+    subset.removed.assign(m_points.size(), false);
+    subset.position.resize(m_points.size());
+    for (primitives::point_id_t k {0}; k < m_points.size(); ++k)
+    {
+        subset.position[m_points[k]] = k;
+    }
+    return subset;
+}
+
+void Tree::remove(Subset& subset, primitives::point_id_t i) const
+{
+    if (subset.removed[i])
+    {
+        return;
+    }
+    subset.removed[i] = true;
+    const auto position {subset.position[i]};
+    node_id_t n {0};
+    while (true)
+    {
+        --subset.remaining[n];
+        const auto& node {m_nodes[n]};
+        if (node.child_count == 0)
+        {
+            return;
+        }
+        auto c {node.first_child};
+        while (m_nodes[c].end <= position)
+        {
+            ++c;
+        }
+        n = c;
+    }
+}
+
+primitives::point_id_t Tree::nearest(const Subset& subset, primitives::point_id_t i) const
+{
+    const auto x {m_x[subset.position[i]]};
+    const auto y {m_y[subset.position[i]]};
+    auto best {constants::invalid_point};
+    auto best_distance {std::numeric_limits<primitives::space_t>::max()};
+    if (m_nodes.empty())
+    {
+        return best;
+    }
+    // Depth-first traversal visiting nearer children first; pruned by the best distance so far.
+    std::array<std::pair<primitives::space_t, node_id_t>, 4 * constants::max_tree_depth> stack;
+    size_t stack_size {0};
+    stack[stack_size++] = {0, 0};
+    while (stack_size > 0)
+    {
+        const auto [node_distance, n] {stack[--stack_size]};
+        if (node_distance >= best_distance or subset.remaining[n] == 0)
+        {
+            continue;
+        }
+        const auto& node {m_nodes[n]};
+        if (node.child_count == 0)
+        {
+            for (auto k {node.begin}; k < node.end; ++k)
+            {
+                const auto p {m_points[k]};
+                if (subset.removed[p] or p == i)
+                {
+                    continue;
+                }
+                const auto dx {m_x[k] - x};
+                const auto dy {m_y[k] - y};
+                const auto distance {dx * dx + dy * dy};
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best = p;
+                }
+            }
+            continue;
+        }
+        const auto children_begin {stack_size};
+        for (auto c {node.first_child}; c < node.first_child + node.child_count; ++c)
+        {
+            if (subset.remaining[c] > 0)
+            {
+                stack[stack_size++] = {distance_squared(m_nodes[c].box, x, y), c};
+            }
+        }
+        // farthest first, so the nearest child is popped next.
+        std::sort(std::begin(stack) + children_begin, std::begin(stack) + stack_size
+            , [](const auto& a, const auto& b) { return a.first > b.first; });
+    }
+    return best;
+}
+
+void Tree::append_inside(const Circle& circle
+    , const Node& leaf
+    , std::vector<primitives::point_id_t>& points) const
+{
+    // Leaves at max depth can exceed the leaf size, so filter in fixed-size chunks:
+    //  a branch-free (vectorizable) distance pass, then compaction of the survivors.
+    constexpr primitives::point_id_t chunk_size {constants::quadtree_leaf_size};
+    const auto radius_squared {circle.radius * circle.radius};
+    for (auto chunk_begin {leaf.begin}; chunk_begin < leaf.end; chunk_begin += chunk_size)
+    {
+        const auto count {std::min<primitives::point_id_t>(chunk_size, leaf.end - chunk_begin)};
+        const auto* x {m_x.data() + chunk_begin};
+        const auto* y {m_y.data() + chunk_begin};
+        std::array<bool, chunk_size> inside;
+        for (primitives::point_id_t k {0}; k < count; ++k)
+        {
+            const auto dx {x[k] - circle.x};
+            const auto dy {y[k] - circle.y};
+            inside[k] = dx * dx + dy * dy <= radius_squared;
+        }
+        for (primitives::point_id_t k {0}; k < count; ++k)
+        {
+            if (inside[k])
+            {
+                points.push_back(m_points[chunk_begin + k]);
+            }
+        }
+    }
+}
+
+} // namespace point_quadtree
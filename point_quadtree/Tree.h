@@ -0,0 +1,78 @@
+#pragma once
+
+// Pointer-free quadtree built from Morton keys.
+// Point ids are sorted by Morton key, so every node owns a contiguous range of
+//  the sorted point array.
+// Nodes are stored breadth-first in a single array; the children of a node
+//  are contiguous and indexed by ascending Morton key quadrant (empty quadrants are skipped).
+// Nodes with at most constants::quadtree_leaf_size points are not subdivided.
+// Coordinates are copied into Morton order so that leaf points can be filtered
+//  with contiguous loads.
+// Node indices have their own width: deep clusters make chains of single-child nodes,
+//  so a tree can have several times more nodes than points.
+
+#include "Box.h"
+#include "Circle.h"
+#include "Domain.h"
+#include <primitives.h>
+
+#include <cstdint> // uint32_t
+#include <vector>
+
+namespace point_quadtree {
+
+class Tree
+{
+public:
+    Tree(const std::vector<primitives::space_t>& x
+        , const std::vector<primitives::space_t>& y
+        , const std::vector<primitives::morton_key_t>& morton_keys
+        , const Domain&);
+
+    // Appends points of all leaves touching search_box.
+    void get_points(primitives::point_id_t i
+        , const Box& search_box
+        , std::vector<primitives::point_id_t>& points) const;
+    // Appends exactly the points inside search_circle.
+    // Returns the number of nodes visited if constants::search_stats, otherwise 0.
+    size_t get_points(primitives::point_id_t i
+        , const Circle& search_circle
+        , std::vector<primitives::point_id_t>& points) const;
+
+    const std::vector<primitives::point_id_t>& points() const { return m_points; }
+    size_t node_count() const { return m_nodes.size(); }
+
+    // A shrinking subset of the points (e.g. not yet visited by a tour construction).
+    // Per-node counts let nearest() skip emptied subtrees.
+    struct Subset
+    {
+        std::vector<primitives::point_id_t> remaining; // points left in each node.
+        std::vector<bool> removed; // by point id.
+        std::vector<primitives::point_id_t> position; // index of each point id in points().
+    };
+    Subset full_subset() const;
+    void remove(Subset&, primitives::point_id_t i) const;
+    // Nearest point in subset to point i (excluding i), or constants::invalid_point if there is none.
+    primitives::point_id_t nearest(const Subset&, primitives::point_id_t i) const;
+
+private:
+    using node_id_t = uint32_t;
+
+    struct Node
+    {
+        Box box;
+        primitives::point_id_t begin {0}; // first index into m_points.
+        primitives::point_id_t end {0}; // one past last index into m_points.
+        node_id_t first_child {0}; // index into m_nodes.
+        primitives::quadrant_t child_count {0}; // 0 for leaves.
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<primitives::point_id_t> m_points; // sorted by Morton key.
+    std::vector<primitives::space_t> m_x; // x[m_points[i]].
+    std::vector<primitives::space_t> m_y; // y[m_points[i]].
+
+    void append_inside(const Circle&, const Node& leaf, std::vector<primitives::point_id_t>& points) const;
+};
+
+} // namespace point_quadtree
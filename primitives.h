@@ -1,14 +1,29 @@
 #pragma once
 
 // Aliases for primitive types.
+// Point id and length widths are chosen at build time (see the makefile variants):
+//  POINT_ID_BITS=16 allows up to 32767 points (constants::max_point_count).
+//  LENGTH_BITS=32 allows tour lengths below 2^32.
+// Narrower types shrink the tour, search and length cache arrays; k-opt checks that
+//  an instance fits (see fits_widths in k-opt.cpp).
 
 #include <cstdint>
 #include <limits>
+#include <type_traits> // conditional_t
+
+#ifndef POINT_ID_BITS
+#define POINT_ID_BITS 32
+#endif
+#ifndef LENGTH_BITS
+#define LENGTH_BITS 64
+#endif
+static_assert(POINT_ID_BITS == 16 or POINT_ID_BITS == 32, "POINT_ID_BITS must be 16 or 32.");
+static_assert(LENGTH_BITS == 32 or LENGTH_BITS == 64, "LENGTH_BITS must be 32 or 64.");
 
 namespace primitives {
 
-using length_t = uint64_t; // as in Segment lengths.
-using point_id_t = uint32_t;
+using length_t = std::conditional_t<LENGTH_BITS == 32, uint32_t, uint64_t>; // as in Segment lengths.
+using point_id_t = std::conditional_t<POINT_ID_BITS == 16, uint16_t, uint32_t>;
 using space_t = double; // as in x, y coordinates.
 
 using depth_t = int; // as in maximum quadtree depth.